@@ -0,0 +1,236 @@
+/** Microbenchmarks for packet encoding and page parsing.
+ *  Build with "make bench" and run bench/packets
+ *  Prints one JSON object per line with the time and heap allocations per operation,
+ *  so that runs on different machines and builds can be compared by a script.
+ *  An optional argument filters the benchmarks to those whose name contains it.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "packet.h"
+#include "packetDatacast.h"
+#include "ttxline.h"
+#include "filemonitor.h"
+
+using namespace vbit;
+
+// count every allocation in the process so each benchmark can report allocations per operation.
+// new and delete are kept out of line so that GCC doesn't warn about malloc and free being paired with them.
+static std::atomic<uint64_t> allocations(0);
+
+__attribute__((noinline)) void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = std::malloc(size ? size : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+static const double MINSECONDS = 0.2; // run each benchmark at least this long
+static std::string filter;
+static volatile uint8_t sink; // results are folded in here so the work can't be optimised away
+
+/** Time an operation, doubling the iterations until the run is long enough to measure */
+template <typename Op> static void Bench(std::string name, Op op)
+{
+    if (name.find(filter) == std::string::npos)
+        return;
+    
+    op(); // warm up caches and any lazily built state
+    
+    long iterations = 1;
+    while (true)
+    {
+        uint64_t allocs = allocations;
+        auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < iterations; i++)
+            op();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        allocs = allocations - allocs;
+        
+        if (elapsed.count() >= MINSECONDS || iterations >= (1L << 30))
+        {
+            char line[256];
+            snprintf(line, sizeof(line), "{\"name\":\"%s\",\"iterations\":%ld,\"ns_per_op\":%.2f,\"allocs_per_op\":%.3f}\n",
+                name.c_str(), iterations, elapsed.count() * 1e9 / iterations, (double)allocs / iterations);
+            std::cout << line << std::flush;
+            return;
+        }
+        iterations *= 2;
+    }
+}
+
+// a row as it appears in a page file, with escaped control codes
+static const std::string TEXTROW = "\x1b" "A" "NEWS " "\x1b" "G" "Headlines from around the world  ";
+static const std::string SUBSTITUTIONROW = "\x1b" "C" "Time " "%%%%%%%%%%%%timedate" " page 100  ";
+
+static std::array<uint8_t, 40> Row(const std::string &text)
+{
+    return TTXLine(text).GetLine();
+}
+
+// an X/26 style row of triplets, three 6 bit bytes each
+static std::array<uint8_t, 40> TripletRow()
+{
+    std::array<uint8_t, 40> row;
+    row[0] = 0; // designation code
+    for (int i = 1; i < 40; i++)
+        row[i] = 0x40 | ((i * 7) & 0x3f);
+    return row;
+}
+
+// a plain text page, a ten subpage carousel and a page with enhancements, as page files
+static std::string TextPage()
+{
+    std::string page = "DE,benchmark text page\r\nPN,10000\r\nSC,0000\r\nPS,8000\r\n";
+    for (int row = 1; row < 24; row++)
+        page += "OL," + std::to_string(row) + "," + TEXTROW + "\r\n";
+    page += "FL,101,102,103,104,8ff,100\r\n";
+    return page;
+}
+
+static std::string CarouselPage()
+{
+    std::string page = "DE,benchmark carousel\r\n";
+    for (int sub = 1; sub <= 10; sub++)
+    {
+        page += "PN,1010" + std::to_string(sub % 10) + "\r\nCT,8,T\r\nPS,8000\r\nSC,000" + std::to_string(sub % 10) + "\r\n";
+        for (int row = 1; row < 24; row++)
+            page += "OL," + std::to_string(row) + ",Subpage " + std::to_string(sub) + " " + TEXTROW + "\r\n";
+        page += "FL,101,102,103,104,8ff,100\r\n";
+    }
+    return page;
+}
+
+static std::string EnhancedPage()
+{
+    std::string page = TextPage();
+    std::array<uint8_t, 40> triplets = TripletRow();
+    std::string enhancement(triplets.begin(), triplets.end());
+    for (int dc = 0; dc < 4; dc++)
+    {
+        enhancement[0] = 0x40 | dc;
+        page += "OL,26," + enhancement + "\r\n";
+    }
+    return page;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1)
+        filter = argv[1];
+    
+    Packet packet(1, 1);
+    std::array<uint8_t, 40> text = Row(TEXTROW);
+    std::array<uint8_t, 40> triplets = TripletRow();
+    std::array<uint8_t, 40> hamming;
+    for (int i = 0; i < 40; i++)
+        hamming[i] = i & 0x0f;
+    
+    // Packet::SetRow for each coding, from an uncached row
+    Bench("SetRow/7bit", [&]{ packet.SetRow(1, 1, text, CODING_7BIT_TEXT); sink = sink + packet.Get_packet()[20]; });
+    Bench("SetRow/8bit", [&]{ packet.SetRow(1, 1, text, CODING_8BIT_DATA); sink = sink + packet.Get_packet()[20]; });
+    Bench("SetRow/triplets", [&]{ packet.SetRow(1, 26, triplets, CODING_13_TRIPLETS); sink = sink + packet.Get_packet()[20]; });
+    Bench("SetRow/hamming84", [&]{ packet.SetRow(1, 1, hamming, CODING_HAMMING_8_4); sink = sink + packet.Get_packet()[20]; });
+    Bench("SetRow/hamming7bitgroups", [&]{ packet.SetRow(1, 1, hamming, CODING_HAMMING_7BIT_GROUPS); sink = sink + packet.Get_packet()[20]; });
+    Bench("SetRow/perpacket", [&]{ packet.SetRow(1, 1, hamming, CODING_PER_PACKET); sink = sink + packet.Get_packet()[20]; });
+    
+    // and from a line with its encoding cached, as pages are sent
+    std::shared_ptr<TTXLine> line(new TTXLine(TEXTROW));
+    Bench("SetRow/7bit/cached", [&]{ packet.SetRow(1, 1, line, CODING_7BIT_TEXT); sink = sink + packet.Get_packet()[20]; });
+    
+    // Packet::Header with the default header template
+    std::string headerTemplate = "VBIT2    %%# %%a %d %%b" "\x03" "%H:%M:%S";
+    Bench("Header", [&]{ packet.Header(1, 0x00, 0x0000, 0x8000, headerTemplate); sink = sink + packet.Get_packet()[20]; });
+    
+    // Packet::tx of a text row which has no substitutions, and one which has.
+    // tx substitutes in place, so each run sends a copy of a packet with the row already set.
+    Packet plain(1, 1);
+    Packet substituted(1, 1);
+    plain.SetRow(1, 1, std::shared_ptr<TTXLine>(new TTXLine(TEXTROW)), CODING_7BIT_TEXT);
+    substituted.SetRow(1, 1, std::shared_ptr<TTXLine>(new TTXLine(SUBSTITUTIONROW)), CODING_7BIT_TEXT);
+    Bench("tx/plain", [&]{ packet = plain; sink = sink + (*packet.tx())[20]; });
+    Bench("tx/substitutions", [&]{ packet = substituted; sink = sink + (*packet.tx())[20]; });
+    
+    // Packet::IDLA with a repeat indicator, continuity indicator and data length
+    std::vector<uint8_t> payload(30, 0x55);
+    Bench("IDLA", [&]{ packet.IDLA(8, Packet::IDLA_RI | Packet::IDLA_CI | Packet::IDLA_DL, 6, 0x123456, 0, 0, payload); sink = sink + packet.Get_packet()[20]; });
+    
+    // Packet::PacketCRC over a text row
+    packet.SetRow(1, 1, text, CODING_7BIT_TEXT);
+    uint16_t crc = 0;
+    Bench("PacketCRC", [&]{ crc = packet.PacketCRC(crc); sink = sink + crc; });
+    
+    // IDL B: load both halves of a bundle, which calculates the forward error correction, then send its 16 packets
+    Debug debug;
+    char arg0[] = "bench", arg1[] = "--dir", arg2[] = "/tmp";
+    char *args[] = {arg0, arg1, arg2};
+    Configure configure(&debug, 3, args);
+    PacketDatacast datacast(1, &configure);
+    std::array<uint8_t, 245> bundle;
+    for (int i = 0; i < 245; i++)
+        bundle[i] = i * 13;
+    Packet out(8, 25);
+    Bench("IDLB/bundle", [&]{
+        datacast.PushIDLBHalf(false, 1, 2, &bundle);
+        datacast.PushIDLBHalf(true, 1, 2, &bundle);
+        int sent = 0;
+        for (int pass = 0; sent < 16 && pass < 16; pass++)
+        {
+            datacast.IsReady(); // moves the bundle into the packet buffer as there is room
+            for (; datacast.GetBufferOccupancy() > 0; sent++)
+                datacast.GetPacket(&out);
+        }
+        if (sent != 16)
+        {
+            std::cerr << "IDL B bundle sent " << sent << " packets, expected 16\n";
+            std::exit(1);
+        }
+        sink = sink + out.Get_packet()[20];
+    });
+    
+    // TTXLine from a page file row
+    Bench("TTXLine/string", [&]{ TTXLine l(TEXTROW); sink = sink + l.GetCharAt(10); });
+    
+    // parsing page files, without the disk read
+    File file("/nonexistent/bench.tti"); // only the name is used, to pick the parser
+    std::string textPage = TextPage();
+    std::string carouselPage = CarouselPage();
+    std::string enhancedPage = EnhancedPage();
+    Bench("LoadTTI/text", [&]{ sink = sink + (file.Parse(textPage) != nullptr); });
+    Bench("LoadTTI/carousel", [&]{ sink = sink + (file.Parse(carouselPage) != nullptr); });
+    Bench("LoadTTI/enhanced", [&]{ sink = sink + (file.Parse(enhancedPage) != nullptr); });
+    
+    return 0;
+}
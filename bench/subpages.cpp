@@ -0,0 +1,82 @@
+/** Benchmark for loading and stepping large subpage carousels.
+ *  Build with "make bench" and run bench/subpages
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "filemonitor.h"
+
+using namespace vbit;
+
+static const int SUBPAGES = 1000;
+
+// write a carousel page with one row of text per subpage
+static std::string WriteCarousel(int subpages)
+{
+    std::string filename = "/tmp/vbit2-bench-carousel.tti";
+    std::ofstream f(filename.c_str());
+    f << "DE,benchmark carousel\r\n";
+    for (int i = 0; i < subpages; i++)
+    {
+        f << "PN,100" << std::setw(2) << std::setfill('0') << (i % 100) << "\r\n";
+        f << "CT,8,T\r\n";
+        f << "PS,8000\r\n";
+        for (int row = 1; row < 24; row++)
+            f << "OL," << row << ",Subpage " << i << " row " << row << "\r\n";
+        f << "FL,100,101,102,103,8ff,100\r\n";
+    }
+    f.close();
+    return filename;
+}
+
+static void Report(std::string name, long iterations, std::chrono::steady_clock::duration elapsed)
+{
+    double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    std::cout << std::left << std::setw(32) << name << std::right << std::setw(10) << iterations << std::setw(14) << std::fixed << std::setprecision(1) << ns / iterations << " ns/op\n";
+}
+
+int main()
+{
+    std::string filename = WriteCarousel(SUBPAGES);
+    
+    const int loads = 20;
+    std::shared_ptr<File> file;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < loads; i++)
+    {
+        file = std::shared_ptr<File>(new File(filename));
+    }
+    Report("load 1000 subpage carousel", loads, std::chrono::steady_clock::now() - start);
+    
+    std::shared_ptr<TTXPageStream> page = file->GetPage();
+    if (page->GetSubpageCount() != SUBPAGES)
+    {
+        std::cerr << "expected " << SUBPAGES << " subpages, loaded " << page->GetSubpageCount() << "\n";
+        return 1;
+    }
+    
+    const long steps = 1000000;
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < steps; i++)
+    {
+        page->StepNextSubpage();
+    }
+    Report("StepNextSubpage", steps, std::chrono::steady_clock::now() - start);
+    
+    const long lookups = 1000000;
+    unsigned int found = 0;
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < lookups; i++)
+    {
+        uint16_t subcode = ((i % 10) << 0) | (((i / 10) % 8) << 4) | (((i / 80) % 10) << 8); // walk the Annex A.1 numbering
+        if (page->LocateSubpage(subcode))
+            found++;
+    }
+    Report("LocateSubpage", lookups, std::chrono::steady_clock::now() - start);
+    
+    std::remove(filename.c_str());
+    return found ? 0 : 1;
+}
@@ -25,65 +25,136 @@ void Carousel::addPage(std::shared_ptr<TTXPageStream> p)
         t += s->GetCycleTime();
     
     p->SetTransitionTime(t);
-    _carouselList.push_front(p);
+    _schedule.insert(std::make_pair(0, p)); // check it on the next call to find its proper place in the schedule
 }
 
 std::shared_ptr<TTXPageStream> Carousel::nextCarousel()
 {
     std::shared_ptr<TTXPageStream> p;
-    if (_carouselList.size()==0) return nullptr;
+    std::shared_ptr<TTXPageStream> result = nullptr;
     
-    for (std::list<std::shared_ptr<TTXPageStream>>::iterator it=_carouselList.begin();it!=_carouselList.end();++it)
+    time_t now = MasterClock::Instance()->GetSeconds();
+    
+    // pages that were locked last time round are due again now
+    for (std::vector<std::shared_ptr<TTXPageStream>>::iterator it=_deferred.begin();it!=_deferred.end();++it)
+        _schedule.insert(std::make_pair(now, *it));
+    _deferred.clear();
+    
+    while (result == nullptr && !_schedule.empty() && _schedule.begin()->first <= now)
     {
-        p=*it;
+        p = _schedule.begin()->second;
+        _schedule.erase(_schedule.begin());
+        
         if (p->GetOneShotFlag())
         {
             p->SetCarouselFlag(false);
-            _carouselList.erase(it--);
             continue;
         }
         
-        if (p->GetLock()) // try to lock this page against changes
+        if (!(p->GetLock())) // try to lock this page against changes
         {
-            if (p->GetIsMarked() && p->GetCarouselFlag()) // only remove it once
-            {
-                std::stringstream ss;
-                ss << "[Carousel::nextCarousel] Deleted " << std::hex << (p->GetPageNumber());
-                _debug->Log(Debug::LogLevels::logINFO,ss.str());
-                
-                p->SetCarouselFlag(false);
-                _carouselList.erase(it--);
-                
-                _pageList->RemovePage(p); // try to remove it from the pagelist immediately - will free the lock
-                continue; // jump back to loop
-            }
-            else if ((!(p->IsCarousel())) || p->Special())
-            {
-                std::stringstream ss;
-                ss << "[Carousel::nextCarousel] no longer a carousel " << std::hex << (p->GetPageNumber());
-                _debug->Log(Debug::LogLevels::logINFO,ss.str());
-                
-                p->SetCarouselFlag(false);
-                _carouselList.erase(it--);
-            }
-            else
+            _debug->PageLockFailed(p->GetPageNumber(), false, p->GetUntransmitted());
+            _deferred.push_back(p); // page is busy so try again next time
+            continue;
+        }
+        
+        if (_drop(p))
+            continue;
+        
+        time_t due = now + 1; // by default check again on the next second
+        
+        if (p->Expired())
+        {
+            // We found a carousel that is ready to step
+            if (std::shared_ptr<Subpage> s = p->GetSubpage()) // make sure there is a subpage
             {
-                if (p->Expired())
+                if (s->GetSubpageStatus() & PAGESTATUS_C9_INTERRUPTED)
                 {
-                    // We found a carousel that is ready to step
-                    if (std::shared_ptr<Subpage> s = p->GetSubpage()) // make sure there is a subpage
-                    {
-                        if (s->GetSubpageStatus() & PAGESTATUS_C9_INTERRUPTED)
-                        {
-                            // carousel should go out now out of sequence
-                            return p; // return page locked
-                        }
-                    }
+                    // carousel should go out now out of sequence
+                    _deferred.push_back(p); // reschedule on the next call once it has been stepped
+                    result = p; // return page locked
+                    continue;
                 }
             }
-            
-            p->FreeLock(); // unlock
+            // otherwise it will be stepped when it is next transmitted as a normal page
+        }
+        else if (p->GetTransitionTime() > now)
+        {
+            due = p->GetTransitionTime(); // sleep until the transition is due
         }
+        
+        _schedule.insert(std::make_pair(due, p));
+        p->FreeLock(); // unlock
+    }
+    
+    return result;
+}
+
+void Carousel::Purge()
+{
+    // This is called from the Service thread once a set of page changes has been applied
+    for (std::multimap<time_t, std::shared_ptr<TTXPageStream>>::iterator it=_schedule.begin(); it!=_schedule.end();)
+    {
+        if (_purge(it->second))
+            it = _schedule.erase(it);
+        else
+            ++it;
     }
-    return nullptr;
+    
+    for (std::vector<std::shared_ptr<TTXPageStream>>::iterator it=_deferred.begin(); it!=_deferred.end();)
+    {
+        if (_purge(*it))
+            it = _deferred.erase(it);
+        else
+            ++it;
+    }
+}
+
+bool Carousel::_purge(std::shared_ptr<TTXPageStream> p)
+{
+    if (p->GetOneShotFlag())
+    {
+        p->SetCarouselFlag(false);
+        return true;
+    }
+    
+    if (!(p->GetIsMarked() || !(p->IsCarousel()) || p->Special()))
+        return false; // still a carousel
+    
+    if (!(p->GetLock()))
+        return false; // busy, so leave it for nextCarousel
+    
+    if (_drop(p))
+        return true;
+    
+    p->FreeLock();
+    return false;
+}
+
+bool Carousel::_drop(std::shared_ptr<TTXPageStream> p)
+{
+    // the page must be locked. It is unlocked if it is dropped.
+    if (p->GetIsMarked() && p->GetCarouselFlag()) // only remove it once
+    {
+        std::stringstream ss;
+        ss << "[Carousel::_drop] Deleted " << std::hex << (p->GetPageNumber());
+        _debug->Log(Debug::LogLevels::logINFO,ss.str());
+        
+        p->SetCarouselFlag(false);
+        _pageList->RemovePage(p); // try to remove it from the pagelist immediately - will free the lock
+        return true;
+    }
+    
+    if ((!(p->IsCarousel())) || p->Special())
+    {
+        std::stringstream ss;
+        ss << "[Carousel::_drop] no longer a carousel " << std::hex << (p->GetPageNumber());
+        _debug->Log(Debug::LogLevels::logINFO,ss.str());
+        
+        p->SetCarouselFlag(false);
+        p->FreeLock(); // unlock
+        return true;
+    }
+    
+    return false;
 }
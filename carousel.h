@@ -1,14 +1,16 @@
 #ifndef _CAROUSEL_H
 #define _CAROUSEL_H
 
-#include <list>
+#include <map>
+#include <vector>
 
 #include "debug.h"
 #include "ttxpagestream.h"
 #include "pagelist.h"
 
-/** Carousel maintains a list of carousel pages.
- *  nextCarousel() iterates through the list to find pages which have hard cycle timings
+/** Carousel maintains a schedule of carousel pages.
+ *  Pages are ordered by the master clock second at which they next need checking, so
+ *  nextCarousel() only visits pages which are due rather than scanning every carousel.
  */
 
 namespace vbit
@@ -31,6 +33,11 @@ class Carousel
          */
         std::shared_ptr<TTXPageStream> nextCarousel();
 
+        /** Drop pages which have been deleted or are no longer carousels, rather than waiting until they are due.
+         *  Called when a set of page changes has been applied between two fields.
+         */
+        void Purge();
+
 
     protected:
 
@@ -39,7 +46,11 @@ class Carousel
         PageList* _pageList;
         Debug* _debug;
 
-        std::list<std::shared_ptr<TTXPageStream>> _carouselList; /// The list of carousel pages
+        std::multimap<time_t, std::shared_ptr<TTXPageStream>> _schedule; /// Carousel pages keyed by when they are next due to be checked
+        std::vector<std::shared_ptr<TTXPageStream>> _deferred; /// Due pages which could not be locked, checked again on the next call
+
+        bool _purge(std::shared_ptr<TTXPageStream> p); // drop a page from the schedule if it has gone
+        bool _drop(std::shared_ptr<TTXPageStream> p); // drop a locked page if it has been deleted or isn't a carousel
 };
 
 }
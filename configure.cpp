@@ -48,16 +48,43 @@ Configure::Configure(Debug *debug, int argc, char** argv) :
     _OutputFormat = T42; // t42 output is the default behaviour
     
     _PID = 0x20; // default PID is 0x20
+    _PMTPID = 0x1000;
+    _tsRate = 0; // don't pad transport stream
+    _language = "und"; // undetermined
     
     _packetServerPort = 0; // port 0 disables packet server
     _packetServerMaxClients = 5; // default to 5 connection limit
     _interfaceServerPort = 0; // port 0 disables interface server
     _interfaceServerMaxClients = 5; // default to 5 connection limit
+    _metricsServerPort = 0; // port 0 disables metrics server
+    
+    _dryRun = false;
+    
+    _outputPath = ""; // write to stdout
+    _cpu = -1; // let the OS schedule the service thread
+    _monitorCPU = -1;
+    _serverCPU = -1;
+    _rtPriority = 0; // normal scheduling
+    _lockMemory = false;
+    _fieldClock = ""; // pace output from the local clock
     
     uint8_t priority[8]={5,5,5,5,5,5,5,5}; // 1=High priority,9=low. Note: priority[0] is mag 8
     
     for (int i=0; i<8; i++)
+    {
         _magazinePriority[i] = priority[i];
+        _magazineWeight[i] = 1; // equal shares
+        _magazineCycleTarget[i] = 0; // no cycle time targets
+    }
+    
+    _magazineScheduling = PriorityScheduling;
+    
+    _fileSettleTime = 1000; // wait for page files to be unchanged for a second before loading them
+    _outputLookahead = 0; // write each packet as soon as it is generated
+    _parallelMagazines = false; // generate all magazines on the service thread
+    _outputBurst = 0; // pace output a field at a time
+    _clockSlew = 0; // resynchronise the master clock in one step
+    _clockResyncThreshold = 10; // seconds, when slewing
 
     //Scan the command line for overriding the pages file.
     if (argc>1)
@@ -147,6 +174,61 @@ Configure::Configure(Debug *debug, int argc, char** argv) :
                     exit(EXIT_FAILURE);
                 }
             }
+            else if (arg == "--pmtpid")
+            {
+                if (i + 1 < argc)
+                {
+                    std::istringstream ss(argv[++i]);
+                    ss >> _PMTPID;
+                    if (_PMTPID < 0x20 || _PMTPID >= 0x1FFF || !ss.eof())
+                    {
+                        std::cerr << "invalid PMT PID\n";
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                else
+                {
+                    std::cerr << "--pmtpid requires an argument\n";
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (arg == "--tsrate")
+            {
+                if (i + 1 < argc)
+                {
+                    errno = 0;
+                    char *end_ptr;
+                    long l = std::strtol(argv[++i], &end_ptr, 10);
+                    if (errno != 0 || *end_ptr != '\0' || l < 1 || l > 100000000)
+                    {
+                        std::cerr << "invalid transport stream rate\n";
+                        exit(EXIT_FAILURE);
+                    }
+                    _tsRate = l;
+                }
+                else
+                {
+                    std::cerr << "--tsrate requires an argument\n";
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (arg == "--language")
+            {
+                if (i + 1 < argc)
+                {
+                    _language = argv[++i];
+                    if (_language.size() != 3 || !std::all_of(_language.begin(), _language.end(), [](char c){ return c >= 'a' && c <= 'z'; }))
+                    {
+                        std::cerr << "invalid language code\n";
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                else
+                {
+                    std::cerr << "--language requires an argument\n";
+                    exit(EXIT_FAILURE);
+                }
+            }
             else if (arg == "--reserved")
             {
                 if (i + 1 < argc)
@@ -259,6 +341,29 @@ Configure::Configure(Debug *debug, int argc, char** argv) :
                     exit(EXIT_FAILURE);
                 }
             }
+            else if (arg == "--metrics")
+            {
+                if (i + 1 < argc)
+                {
+                    errno = 0;
+                    char *end_ptr;
+                    long l = std::strtol(argv[++i], &end_ptr, 10);
+                    if (errno == 0 && *end_ptr == '\0' && l > 0 && l < 65536)
+                    {
+                        _metricsServerPort = (int)l;
+                    }
+                    else
+                    {
+                        std::cerr << "invalid metrics port number\n";
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                else
+                {
+                    std::cerr << "--metrics requires a port number\n";
+                    exit(EXIT_FAILURE);
+                }
+            }
             else if (arg == "--interface")
             {
                 if (i + 1 < argc)
@@ -302,6 +407,98 @@ Configure::Configure(Debug *debug, int argc, char** argv) :
                     exit(EXIT_FAILURE);
                 }
             }
+            else if (arg == "--output")
+            {
+                if (i + 1 < argc)
+                    _outputPath = argv[++i];
+                else
+                {
+                    std::cerr << "--output requires an argument\n";
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (arg == "--cpu" || arg == "--monitor-cpu" || arg == "--server-cpu")
+            {
+                if (i + 1 < argc)
+                {
+                    errno = 0;
+                    char *end_ptr;
+                    long l = std::strtol(argv[++i], &end_ptr, 10);
+                    if (errno == 0 && *end_ptr == '\0' && l >= 0 && l < 1024)
+                    {
+                        if (arg == "--cpu")
+                            _cpu = (int)l;
+                        else if (arg == "--monitor-cpu")
+                            _monitorCPU = (int)l;
+                        else
+                            _serverCPU = (int)l;
+                    }
+                    else
+                    {
+                        std::cerr << "invalid cpu number\n";
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                else
+                {
+                    std::cerr << arg << " requires an argument\n";
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (arg == "--rtprio")
+            {
+                if (i + 1 < argc)
+                {
+                    errno = 0;
+                    char *end_ptr;
+                    long l = std::strtol(argv[++i], &end_ptr, 10);
+                    if (errno == 0 && *end_ptr == '\0' && l >= 1 && l <= 99)
+                    {
+                        _rtPriority = (int)l;
+                    }
+                    else
+                    {
+                        std::cerr << "invalid real-time priority\n";
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                else
+                {
+                    std::cerr << "--rtprio requires an argument\n";
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (arg == "--mlock")
+            {
+                _lockMemory = true;
+            }
+            else if (arg == "--fieldclock")
+            {
+                if (i + 1 < argc)
+                {
+                    _fieldClock = argv[++i];
+                    if (_fieldClock.compare(0, 4, "udp:") == 0)
+                    {
+                        errno = 0;
+                        char *end_ptr;
+                        long l = std::strtol(_fieldClock.c_str() + 4, &end_ptr, 10);
+                        if (errno != 0 || *end_ptr != '\0' || l < 1 || l > 65535)
+                        {
+                            std::cerr << "invalid field clock port\n";
+                            exit(EXIT_FAILURE);
+                        }
+                    }
+                }
+                else
+                {
+                    std::cerr << "--fieldclock requires an argument\n";
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (arg == "--dry-run")
+            {
+                _dryRun = true;
+            }
             else
             {
                 std::cerr << "unrecognised argument: " << arg << std::endl;
@@ -310,6 +507,12 @@ Configure::Configure(Debug *debug, int argc, char** argv) :
         }
     }
     
+    if (_PMTPID == _PID)
+    {
+        std::cerr << "PMT PID must differ from teletext PID\n";
+        exit(EXIT_FAILURE);
+    }
+    
     if (!DirExists(&_pageDir))
     {
         std::stringstream ss;
@@ -356,7 +559,7 @@ int Configure::LoadConfigFile(std::string filename)
 
     std::vector<std::string>::iterator iter;
     // these are all the valid strings for config lines
-    std::vector<std::string> nameStrings{ "header_template", "initial_teletext_page", "row_adaptive_mode", "network_identification_code", "country_network_identification", "full_field", "status_display","lines_per_field","datacast_lines","magazine_priority"};
+    std::vector<std::string> nameStrings{ "header_template", "initial_teletext_page", "row_adaptive_mode", "network_identification_code", "country_network_identification", "full_field", "status_display","lines_per_field","datacast_lines","magazine_priority","magazine_scheduler","magazine_weights","magazine_cycle_target","file_settle_time","output_lookahead","parallel_magazines","output_burst","clock_slew","clock_resync_threshold"};
 
     if (filein.is_open())
     {
@@ -548,37 +751,174 @@ int Configure::LoadConfigFile(std::string filename)
                             }
                             case 9: // "magazine_priority"
                             {
-                                std::stringstream ss(value);
-                                std::string temps;
-                                int tmp[8];
-                                int i;
-                                for (i=0; i<8; i++)
+                                error = ParseMagazineList(value, _magazinePriority, 1, 9); // must be 1-9
+                                break;
+                            }
+                            case 10: // "magazine_scheduler"
+                            {
+                                if (!value.compare("priority"))
+                                {
+                                    _magazineScheduling = PriorityScheduling;
+                                }
+                                else if (!value.compare("weighted"))
+                                {
+                                    _magazineScheduling = WeightedScheduling;
+                                }
+                                else
+                                {
+                                    error = 1;
+                                }
+                                break;
+                            }
+                            case 11: // "magazine_weights"
+                            {
+                                error = ParseMagazineList(value, _magazineWeight, 1, 100); // must be 1-100
+                                break;
+                            }
+                            case 12: // "magazine_cycle_target"
+                            {
+                                error = ParseMagazineList(value, _magazineCycleTarget, 0, 600); // seconds, 0 for none
+                                break;
+                            }
+                            case 13: // "file_settle_time"
+                            {
+                                if (value.size() > 0 && value.size() < 6)
                                 {
-                                    if (std::getline(ss, temps, ','))
+                                    try
                                     {
-                                        try
-                                        {
-                                            tmp[i] = stoi(temps);
-                                        }
-                                        catch (const std::invalid_argument& ia)
-                                        {
-                                            error = 1;
-                                            break;
-                                        }
-                                        if (!(tmp[i] > 0 && tmp[i] < 10)) // must be 1-9
-                                        {
-                                            error = 1;
-                                            break;
-                                        }
+                                        _fileSettleTime = stoi(value);
                                     }
-                                    else
+                                    catch (const std::invalid_argument& ia)
                                     {
                                         error = 1;
                                         break;
                                     }
+                                    if (_fileSettleTime < 0)
+                                    {
+                                        _fileSettleTime = 0;
+                                        error = 1;
+                                    }
+                                }
+                                else
+                                {
+                                    error = 1;
+                                }
+                                break;
+                            }
+                            case 14: // "output_lookahead"
+                            {
+                                if (value.size() > 0 && value.size() < 3)
+                                {
+                                    try
+                                    {
+                                        _outputLookahead = stoi(value);
+                                    }
+                                    catch (const std::invalid_argument& ia)
+                                    {
+                                        error = 1;
+                                        break;
+                                    }
+                                    if (_outputLookahead < 0 || _outputLookahead > 25)
+                                    {
+                                        _outputLookahead = 0;
+                                        error = 1;
+                                    }
+                                }
+                                else
+                                {
+                                    error = 1;
+                                }
+                                break;
+                            }
+                            case 15: // "parallel_magazines"
+                            {
+                                if (!value.compare("true"))
+                                {
+                                    _parallelMagazines = true;
+                                }
+                                else if (!value.compare("false"))
+                                {
+                                    _parallelMagazines = false;
+                                }
+                                else
+                                {
+                                    error = 1;
+                                }
+                                break;
+                            }
+                            case 16: // "output_burst"
+                            {
+                                if (value.size() > 0 && value.size() < 4)
+                                {
+                                    try
+                                    {
+                                        _outputBurst = stoi(value);
+                                    }
+                                    catch (const std::invalid_argument& ia)
+                                    {
+                                        error = 1;
+                                        break;
+                                    }
+                                    if (_outputBurst < 0)
+                                    {
+                                        _outputBurst = 0;
+                                        error = 1;
+                                    }
+                                }
+                                else
+                                {
+                                    error = 1;
+                                }
+                                break;
+                            }
+                            case 17: // "clock_slew"
+                            {
+                                if (value.size() > 0 && value.size() < 6)
+                                {
+                                    try
+                                    {
+                                        _clockSlew = stoi(value);
+                                    }
+                                    catch (const std::invalid_argument& ia)
+                                    {
+                                        error = 1;
+                                        break;
+                                    }
+                                    if (_clockSlew < 0 || _clockSlew > 32767) // reported as a signed 16 bit value by CONFOUTPUT
+                                    {
+                                        _clockSlew = 0;
+                                        error = 1;
+                                    }
+                                }
+                                else
+                                {
+                                    error = 1;
+                                }
+                                break;
+                            }
+                            case 18: // "clock_resync_threshold"
+                            {
+                                if (value.size() > 0 && value.size() < 5)
+                                {
+                                    try
+                                    {
+                                        _clockResyncThreshold = stoi(value);
+                                    }
+                                    catch (const std::invalid_argument& ia)
+                                    {
+                                        error = 1;
+                                        break;
+                                    }
+                                    if (_clockResyncThreshold < 1)
+                                    {
+                                        _clockResyncThreshold = 10;
+                                        error = 1;
+                                    }
+                                }
+                                else
+                                {
+                                    error = 1;
                                 }
-                                for (i=0; i<8; i++)
-                                    _magazinePriority[i] = tmp[i];
                                 break;
                             }
                         }
@@ -603,3 +943,39 @@ int Configure::LoadConfigFile(std::string filename)
         return -1;
     }
 }
+
+/** Parse eight comma separated values for magazines 8,1,2,3,4,5,6,7
+ *  @param list array of eight values which is only updated if all values are valid
+ *  @return 0 on success, 1 on error
+ */
+int Configure::ParseMagazineList(std::string value, int *list, int min, int max)
+{
+    std::stringstream ss(value);
+    std::string temps;
+    int tmp[8];
+    for (int i=0; i<8; i++)
+    {
+        if (std::getline(ss, temps, ','))
+        {
+            try
+            {
+                tmp[i] = stoi(temps);
+            }
+            catch (const std::invalid_argument& ia)
+            {
+                return 1;
+            }
+            if (tmp[i] < min || tmp[i] > max)
+            {
+                return 1;
+            }
+        }
+        else
+        {
+            return 1;
+        }
+    }
+    for (int i=0; i<8; i++)
+        list[i] = tmp[i];
+    return 0;
+}
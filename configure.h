@@ -35,6 +35,12 @@ class Configure
             TSNPTS
         };
         
+        enum MagazineScheduling
+        {
+            PriorityScheduling,
+            WeightedScheduling
+        };
+        
         //Configure();
         /** Constructor can take overrides from the command line
          */
@@ -60,9 +66,21 @@ class Configure
         uint16_t GetDatacastLines(){return _datacastLines;}
         bool GetReverseFlag(){return _reverseBits;}
         int GetMagazinePriority(uint8_t mag){return _magazinePriority[mag];}
+        MagazineScheduling GetMagazineScheduling(){return _magazineScheduling;}
+        int GetMagazineWeight(uint8_t mag){return _magazineWeight[mag];}
+        int GetMagazineCycleTarget(uint8_t mag){return _magazineCycleTarget[mag];}
+        int GetFileSettleTime(){return _fileSettleTime;}
+        int GetOutputLookahead(){return _outputLookahead;}
+        bool GetParallelMagazines(){return _parallelMagazines;}
+        int GetOutputBurst(){return _outputBurst;}
+        int GetClockSlew(){return _clockSlew;}
+        int GetClockResyncThreshold(){return _clockResyncThreshold;}
         
         OutputFormat GetOutputFormat(){return _OutputFormat;}
         uint16_t GetTSPID(){return _PID;}
+        uint16_t GetPMTPID(){return _PMTPID;}
+        uint32_t GetTSRate(){return _tsRate;}
+        std::string GetLanguage(){return _language;}
         
         uint16_t GetPacketServerPort(){return _packetServerPort;}
         bool GetPacketServerEnabled(){return _packetServerPort != 0;}
@@ -72,11 +90,25 @@ class Configure
         bool GetInterfaceServerEnabled(){return _interfaceServerPort != 0;}
         uint16_t GetInterfaceServerMaxClients(){return _interfaceServerMaxClients;}
         
+        uint16_t GetMetricsServerPort(){return _metricsServerPort;}
+        bool GetMetricsServerEnabled(){return _metricsServerPort != 0;}
+        
+        bool GetDryRun(){return _dryRun;}
+        
+        std::string GetOutputPath(){return _outputPath;}
+        int GetCPU(){return _cpu;}
+        int GetMonitorCPU(){return _monitorCPU;}
+        int GetServerCPU(){return _serverCPU;}
+        int GetRealTimePriority(){return _rtPriority;}
+        bool GetLockMemory(){return _lockMemory;}
+        std::string GetFieldClock(){return _fieldClock;}
+        
     private:
         Debug* _debug;
         int DirExists(std::string *path);
         
         int LoadConfigFile(std::string filename);
+        int ParseMagazineList(std::string value, int *list, int min, int max);
         
         // template string for generating header packets
         std::string _headerTemplate;
@@ -88,6 +120,15 @@ class Configure
         // settings for generation of packet 8/30
         bool _multiplexedSignalFlag; // false indicates teletext is multiplexed with video, true means full frame teletext.
         int _magazinePriority[8];
+        MagazineScheduling _magazineScheduling;
+        int _magazineWeight[8];
+        int _magazineCycleTarget[8]; // seconds, 0 for no target
+        int _fileSettleTime; // milliseconds
+        int _outputLookahead; // fields of packets generated ahead of output, 0 to write inline
+        bool _parallelMagazines; // generate each magazine's packets on its own thread
+        int _outputBurst; // lines written at each output wake up, 0 for a whole field
+        int _clockSlew; // most ppm the output rate is adjusted by to keep the master clock in step, 0 to step it instead
+        int _clockResyncThreshold; // seconds the master clock may be out before it is stepped when slewing
         uint8_t _initialMag;
         uint8_t _initialPage;
         uint16_t _initialSubcode;
@@ -102,11 +143,25 @@ class Configure
         
         OutputFormat _OutputFormat;
         uint16_t _PID;
+        uint16_t _PMTPID; /// PID of the program map table --pmtpid
+        uint32_t _tsRate; /// transport stream bits per second padded with null packets, or 0 for no padding --tsrate
+        std::string _language; /// ISO 639 language code for the transport stream teletext descriptor --language
         
         uint16_t _packetServerPort;
         uint16_t _packetServerMaxClients;
         uint16_t _interfaceServerPort;
         uint16_t _interfaceServerMaxClients;
+        uint16_t _metricsServerPort;
+        
+        bool _dryRun; /// load pages, print predicted magazine cycle times, and exit
+        
+        std::string _outputPath; /// file or pipe to write the output stream to instead of stdout --output
+        int _cpu; /// processor to run the service thread on, or -1 for any --cpu
+        int _monitorCPU; /// processor for the file monitor thread, or -1 for any --monitor-cpu
+        int _serverCPU; /// processor for the packet and interface server threads, or -1 for any --server-cpu
+        int _rtPriority; /// SCHED_FIFO priority for the service thread, or 0 for normal scheduling --rtprio
+        bool _lockMemory; /// lock the process into RAM --mlock
+        std::string _fieldClock; /// external field clock source, a named pipe or udp:<port> --fieldclock
     };
 }
 
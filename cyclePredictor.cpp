@@ -0,0 +1,163 @@
+/** CyclePredictor
+ */
+#include "cyclePredictor.h"
+
+using namespace vbit;
+
+CyclePredictor::CyclePredictor(Configure *configure, PageList *pageList) :
+    _configure(configure),
+    _pageList(pageList)
+{
+}
+
+int CyclePredictor::SubpagePackets(std::shared_ptr<TTXPageStream> page, std::shared_ptr<Subpage> subpage)
+{
+    int packets = 1; // header
+    
+    for (int row = 26; row <= 28; row++)
+    {
+        for (std::shared_ptr<TTXLine> line = subpage->GetRow(row); line != nullptr; line = line->GetNextLine())
+            packets++;
+    }
+    
+    bool lop = page->GetPageFunction() == LOP;
+    for (int row = 1; row < 26; row++)
+    {
+        // match the row skipping in PacketMag::GetPacket
+        if (!(subpage->GetRow(row)->IsBlank() && (_configure->GetRowAdaptive() || row == 25 || !lop)))
+            packets++;
+    }
+    
+    return packets;
+}
+
+std::array<CyclePredictor::Prediction, 8> CyclePredictor::Predict()
+{
+    std::array<Prediction, 8> result;
+    std::array<std::vector<double>, 8> transmissions; // packets in each page transmission of the cycle
+    std::array<double, 8> share;
+    
+    // Measure the pages between two fields, when the service thread is not changing the page lists and the
+    // magazines are paused, so no page lock is taken and no transmission is lost to the predictor.
+    std::array<std::vector<std::pair<double, int>>, 8> sizes; // average packets and repeat of each page
+    _pageList->RunAtFieldBoundary([this, &sizes]()
+    {
+        for (int mag = 0; mag < 8; mag++)
+        {
+            std::list<std::shared_ptr<TTXPageStream>> list = _pageList->GetPages(mag);
+            for (std::list<std::shared_ptr<TTXPageStream>>::iterator it = list.begin(); it != list.end(); ++it)
+            {
+                std::shared_ptr<TTXPageStream> page = *it;
+                
+                if ((page->GetPageNumber() & 0xFF) == 0xFF || page->Special() || page->GetIsMarked())
+                    continue; // not part of the normal magazine cycle
+                
+                // carousels send one subpage per cycle so use the average size of their subpages
+                std::vector<std::shared_ptr<Subpage>> subpages = page->GetSubpages();
+                double size = 0;
+                int count = 0;
+                for (std::vector<std::shared_ptr<Subpage>>::iterator s = subpages.begin(); s != subpages.end(); ++s)
+                {
+                    if ((*s)->GetSubpageStatus() & PAGESTATUS_TRANSMITPAGE)
+                    {
+                        size += SubpagePackets(page, *s);
+                        count++;
+                    }
+                }
+                if (count == 0)
+                    continue;
+                
+                int repeat = page->GetRepeat();
+                if (repeat > 1 && page->IsCarousel())
+                    repeat = 1; // carousels are not repeated
+                
+                sizes[mag].push_back(std::make_pair(size / count, repeat));
+            }
+        }
+    });
+    
+    for (int mag = 0; mag < 8; mag++)
+    {
+        double packets = 0;
+        double pages = 0;
+        
+        for (std::vector<std::pair<double, int>>::iterator it = sizes[mag].begin(); it != sizes[mag].end(); ++it)
+        {
+            double size = it->first;
+            int repeat = it->second;
+            
+            if (repeat > 1)
+            {
+                for (int i = 0; i < repeat; i++)
+                    transmissions[mag].push_back(size);
+                pages += repeat;
+                packets += size * repeat;
+            }
+            else
+            {
+                double weight = (repeat < -1) ? 1.0 / -repeat : 1.0; // pages sent every few cycles count pro rata
+                transmissions[mag].push_back(size * weight);
+                pages += weight;
+                packets += size * weight;
+            }
+        }
+        
+        result[mag].pages = (int)(pages + 0.5);
+        result[mag].packets = transmissions[mag].empty() ? 0 : (int)(packets + 0.5) + 1; // plus the time filling header ending the cycle
+        
+        if (transmissions[mag].empty())
+            share[mag] = 0; // magazines without pages take no lines
+        else if (_configure->GetMagazineScheduling() == Configure::MagazineScheduling::WeightedScheduling)
+            share[mag] = _configure->GetMagazineWeight(mag);
+        else
+            share[mag] = 1.0 / _configure->GetMagazinePriority(mag); // priority n gets one turn in n
+    }
+    
+    // lines per field available to magazines after dedicated datacast lines and 8/30 every tenth field
+    double lines = _configure->GetLinesPerField() - _configure->GetDatacastLines() - 0.1;
+    if (lines < 0.1)
+        lines = 0.1;
+    
+    // Each field the lines are shared between the magazines that are ready to send, in proportion to
+    // their share. A magazine is not ready while its rows wait for the field after a header, or while
+    // it is held because its cycle is shorter than one second, and other magazines use those lines.
+    // Estimate how much of the time each magazine is busy and iterate until the cycle times settle.
+    std::array<double, 8> busy; // fraction of time each magazine is ready to send
+    std::array<double, 8> fields;
+    for (int mag = 0; mag < 8; mag++)
+    {
+        busy[mag] = transmissions[mag].empty() ? 0 : 1;
+        fields[mag] = 0;
+    }
+    
+    for (int pass = 0; pass < 20; pass++)
+    {
+        std::array<double, 8> next;
+        for (int mag = 0; mag < 8; mag++)
+        {
+            next[mag] = 0;
+            if (transmissions[mag].empty())
+                continue;
+            
+            double competing = share[mag];
+            for (int other = 0; other < 8; other++)
+                if (other != mag)
+                    competing += share[other] * busy[other];
+            double bandwidth = lines * share[mag] / competing; // lines per field while ready
+            
+            fields[mag] = 1; // time filling header
+            for (std::vector<double>::iterator t = transmissions[mag].begin(); t != transmissions[mag].end(); ++t)
+                fields[mag] += std::max(1.0, 0.5 + *t / bandwidth); // rows wait for the next field after the header, on average half a field
+            if (fields[mag] < 50)
+                fields[mag] = 50; // cycle held until the next second
+            
+            next[mag] = std::min(1.0, (result[mag].packets / bandwidth) / fields[mag]);
+        }
+        busy = next;
+    }
+    
+    for (int mag = 0; mag < 8; mag++)
+        result[mag].fields = (int)(fields[mag] + 0.5);
+    
+    return result;
+}
@@ -0,0 +1,44 @@
+#ifndef _CYCLEPREDICTOR_H_
+#define _CYCLEPREDICTOR_H_
+
+#include <array>
+#include <vector>
+
+#include "configure.h"
+#include "pagelist.h"
+#include "ttxpagestream.h"
+
+namespace vbit
+{
+    /** CyclePredictor estimates magazine cycle times from the pages currently loaded.
+     *  It counts the packets each page will produce, shares the VBI lines left after datacast and BSDP
+     *  between the magazines according to the scheduling settings, and allows for the page erasure
+     *  interval and the one second minimum magazine cycle.
+     */
+    class CyclePredictor
+    {
+        public:
+            struct Prediction
+            {
+                int pages; // page transmissions per cycle
+                int packets; // packets per cycle including headers
+                int fields; // predicted cycle time in fields
+            };
+            
+            CyclePredictor(Configure *configure, PageList *pageList);
+            
+            /** Waits for the start of a field to measure the pages while the magazines are paused.
+             *  @return predictions indexed by magazine number where 0 is magazine 8
+             */
+            std::array<Prediction, 8> Predict();
+            
+        private:
+            Configure* _configure;
+            PageList* _pageList;
+            
+            /** Count the packets sent for one transmission of a subpage */
+            int SubpagePackets(std::shared_ptr<TTXPageStream> page, std::shared_ptr<Subpage> subpage);
+    };
+}
+
+#endif
@@ -1,13 +1,38 @@
 #include <debug.h>
+#include <cstdio>
 
 using namespace vbit;
 
+std::atomic<int> Debug::_dumpRequests(0);
+
 Debug::Debug() :
-    _debugLevel(logNONE)
+    _debugLevel(logNONE),
+    _outputQueue(0),
+    _outputUnderruns(0),
+    _jitterMean(0),
+    _jitterMax(0),
+    _clockResyncs(0),
+    _clockSlews(0),
+    _clockSlewRate(0),
+    _lineSecond(0),
+    _dumpsDone(_dumpRequests)
 {
     //ctor
-    _magDurations.fill(-1);
-    _magSizes.fill(0);
+    for (int i=0; i<srcCOUNT; i++)
+        _packets[i] = 0;
+    for (int i=0; i<loadCOUNT; i++)
+        _pageLoads[i] = 0;
+    LineUsage empty = {};
+    _lineSeconds.fill(empty);
+    for (int i=0; i<8; i++)
+    {
+        _magDurations[i] = -1;
+        _magSizes[i] = 0;
+        _updatedPagesQueued[i] = 0;
+        _lockFailures[i] = 0;
+        _skippedTransmissions[i] = 0;
+        _longestGaps[i] = 0;
+    }
 }
 
 Debug::~Debug()
@@ -31,6 +56,22 @@ void Debug::SetMagCycleDuration(int mag, int duration)
     }
 }
 
+std::array<int,8> Debug::GetMagCycleDurations()
+{
+    std::array<int,8> durations;
+    for (int i=0; i<8; i++)
+        durations[i] = _magDurations[i];
+    return durations;
+}
+
+std::array<int,8> Debug::GetMagSizes()
+{
+    std::array<int,8> sizes;
+    for (int i=0; i<8; i++)
+        sizes[i] = _magSizes[i];
+    return sizes;
+}
+
 void Debug::SetMagazineSize(int mag, int size)
 {
     if (mag >= 0 && mag < 8)
@@ -39,3 +80,128 @@ void Debug::SetMagazineSize(int mag, int size)
         Log(logDEBUG, "[Debug::SetMagazineSize] Magazine " + std::to_string(mag) + " size: " + std::to_string(size) + " pages");
     }
 }
+
+const char* Debug::GetStageName(Stages stage)
+{
+    static const char* names[stageCOUNT] = {"getpacket", "tx", "output", "write", "sendfield", "parse", "interface"};
+    return names[stage];
+}
+
+const char* Debug::GetLineUseName(LineUses use)
+{
+    static const char* names[lineCOUNT] = {"magazine", "bsdp", "debug", "datacast", "bsdp", "datacast", "erasure", "cycle", "nopages", "nopacket", "notready"};
+    return names[use];
+}
+
+void Debug::AddFieldLines(const std::array<uint16_t, lineCOUNT> &lines)
+{
+    std::lock_guard<std::mutex> lock(_lineMtx);
+    
+    if (_lineSeconds[_lineSecond].fields >= 50)
+    {
+        // start the next second, overwriting the oldest
+        _lineSecond = (_lineSecond + 1) % _lineSeconds.size();
+        LineUsage empty = {};
+        _lineSeconds[_lineSecond] = empty;
+    }
+    
+    LineUsage &usage = _lineSeconds[_lineSecond];
+    uint32_t filler = 0;
+    for (int i = 0; i < lineCOUNT; i++)
+    {
+        usage.lines[i] += lines[i];
+        if (i >= lineFILLER)
+            filler += lines[i];
+    }
+    usage.fields++;
+    if (filler > usage.maxFiller)
+        usage.maxFiller = filler;
+}
+
+Debug::LineUsage Debug::GetLineUsage(int seconds)
+{
+    std::lock_guard<std::mutex> lock(_lineMtx);
+    
+    LineUsage total = {};
+    if (seconds > LINEUSAGESECONDS)
+        seconds = LINEUSAGESECONDS;
+    
+    for (int i = 1; i <= seconds; i++)
+    {
+        // step back from the second being filled
+        LineUsage &usage = _lineSeconds[(_lineSecond + _lineSeconds.size() - i) % _lineSeconds.size()];
+        for (int j = 0; j < lineCOUNT; j++)
+            total.lines[j] += usage.lines[j];
+        total.fields += usage.fields;
+        if (usage.maxFiller > total.maxFiller)
+            total.maxFiller = usage.maxFiller;
+    }
+    return total;
+}
+
+void Debug::PageLockFailed(int page, bool skipped, int64_t untransmitted)
+{
+    int mag = (page >> 8) & 7;
+    _lockFailures[mag]++;
+    if (skipped)
+        _skippedTransmissions[mag]++;
+    
+    {
+        std::lock_guard<std::mutex> lock(_pageLockMtx);
+        PageLockStats &stats = _pageLockStats[page]; // zeroed if new
+        stats.lockFailures++;
+        if (skipped)
+            stats.skipped++;
+    }
+    
+    PageGap(page, untransmitted); // a page held locked is starving now, not only when it is next sent
+}
+
+void Debug::PageGap(int page, int64_t fields)
+{
+    int mag = (page >> 8) & 7;
+    int64_t longest = _longestGaps[mag];
+    while (fields > longest && !_longestGaps[mag].compare_exchange_weak(longest, fields));
+    
+    // only pages which have been found locked are listed
+    std::lock_guard<std::mutex> lock(_pageLockMtx);
+    std::map<int, PageLockStats>::iterator it = _pageLockStats.find(page);
+    if (it != _pageLockStats.end() && fields > it->second.longestGap)
+        it->second.longestGap = fields;
+}
+
+std::map<int, Debug::PageLockStats> Debug::GetPageLockStats()
+{
+    std::lock_guard<std::mutex> lock(_pageLockMtx);
+    return _pageLockStats;
+}
+
+void Debug::CheckDump()
+{
+    int requests = _dumpRequests;
+    if (requests == _dumpsDone)
+        return;
+    _dumpsDone = requests;
+    
+    std::string dump = "[Debug::CheckDump] Stage latencies in microseconds\n";
+    char line[128];
+    snprintf(line, sizeof(line), "%-10s %10s %9s %9s %9s %9s %9s %9s\n", "stage", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+    dump += line;
+    for (int i = 0; i < stageCOUNT; i++)
+    {
+        LatencyHistogram &h = _histograms[i];
+        snprintf(line, sizeof(line), "%-10s %10llu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", GetStageName((Stages)i), (unsigned long long)h.GetCount(),
+            h.GetMean() / 1000.0, h.GetPercentile(0.5) / 1000.0, h.GetPercentile(0.9) / 1000.0, h.GetPercentile(0.99) / 1000.0, h.GetPercentile(0.999) / 1000.0, h.GetMax() / 1000.0);
+        dump += line;
+    }
+    
+    LineUsage usage = GetLineUsage(10);
+    snprintf(line, sizeof(line), "[Debug::CheckDump] Lines per field over the last %u fields, most filler in one field %u\n", usage.fields, usage.maxFiller);
+    dump += line;
+    for (int i = 0; i < lineCOUNT; i++)
+    {
+        snprintf(line, sizeof(line), "%-8s %-10s %6.2f\n", i < lineFILLER ? "sent" : "filler", GetLineUseName((LineUses)i), usage.fields ? (double)usage.lines[i] / usage.fields : 0.0);
+        dump += line;
+    }
+    std::cerr << dump; // always, whatever the debug level
+}
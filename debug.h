@@ -5,6 +5,12 @@
 
 #include <iostream>
 #include <array>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <map>
+
+#include "latencyHistogram.h"
 
 namespace vbit
 {
@@ -20,6 +26,75 @@ namespace vbit
                 logDEBUG
             };
             
+            /** Where transmitted packets came from */
+            enum PacketSources
+            {
+                srcMAGAZINE, // to srcMAGAZINE + 7, indexed by magazine where 0 is magazine 8
+                srcBSDP = srcMAGAZINE + 8,
+                srcDEBUG,
+                srcDATACAST,
+                srcFILLER,
+                srcCOUNT
+            };
+            
+            /** What each VBI line carried, or why it was filler */
+            enum LineUses
+            {
+                lineMAGAZINE,
+                lineBSDP,
+                lineDEBUG,
+                lineDATACAST,
+                fillBSDP, // packet 8/30 was due but had nothing to send
+                fillDATACAST, // a dedicated datacast line with nothing buffered
+                fillERASURE, // magazines waiting out the 20ms page erasure interval
+                fillCYCLE, // magazines which finished their cycle waiting for the next second
+                fillNOPAGES, // no magazine has any pages
+                fillNOPACKET, // a magazine was ready but returned no packet, e.g. its pages were locked
+                fillNOTREADY, // magazines not ready for any other reason, e.g. not yet built ahead
+                lineCOUNT
+            };
+            static const int lineFILLER = fillBSDP; // this and later uses are filler
+            
+            /** Line uses totalled over a number of fields */
+            struct LineUsage
+            {
+                std::array<uint32_t, lineCOUNT> lines;
+                uint32_t fields;
+                uint32_t maxFiller; // most filler lines in any one field
+            };
+            static const int LINEUSAGESECONDS = 60; // longest window kept
+            
+            /** Contention for one page's lock between transmission and editing */
+            struct PageLockStats
+            {
+                uint32_t lockFailures; // times the magazine found the page locked
+                uint32_t skipped; // of which the page lost its transmission rather than being retried
+                int64_t longestGap; // longest time between transmissions in fields
+            };
+            
+            /** Outcomes of the file monitor reading a page file */
+            enum PageLoads
+            {
+                loadADDED, // a new page
+                loadRELOADED, // a page's content was replaced
+                loadUNCHANGED, // the file changed but the page did not
+                loadFAILED, // the file could not be parsed
+                loadCOUNT
+            };
+            
+            /** Stages of the service whose durations are recorded */
+            enum Stages
+            {
+                stageGETPACKET, // PacketMag::GetPacket
+                stageTX, // Packet::tx
+                stageOUTPUT, // Service::_packetOutput, including any wait for room in the look-ahead queue
+                stageWRITE, // writing a line to the output stream
+                stageSENDFIELD, // PacketServer::SendField
+                stagePARSE, // reading and parsing a page file
+                stageINTERFACE, // handling an interface server command
+                stageCOUNT
+            };
+            
             /** Default constructor */
             Debug();
             /** Default destructor */
@@ -29,16 +104,84 @@ namespace vbit
             void SetDebugLevel(LogLevels level){ _debugLevel = level; };
             LogLevels GetDebugLevel(){ return _debugLevel; };
             void SetMagCycleDuration(int mag, int duration);
-            std::array<int,8> GetMagCycleDurations(){ return _magDurations; };
+            std::array<int,8> GetMagCycleDurations();
             void SetMagazineSize(int mag, int size);
-            std::array<int,8> GetMagSizes(){ return _magSizes; };
+            std::array<int,8> GetMagSizes();
+            void SetOutputQueue(int lines){ _outputQueue = lines; };
+            int GetOutputQueue(){ return _outputQueue; }; // lines generated but not yet written
+            void OutputUnderrun(){ _outputUnderruns++; };
+            uint32_t GetOutputUnderruns(){ return _outputUnderruns; }; // times the output waited for packets
+            void SetPacingJitter(int mean, int max){ _jitterMean = mean; _jitterMax = max; };
+            int GetPacingJitterMean(){ return _jitterMean; }; // microseconds late waking for output over the last second
+            int GetPacingJitterMax(){ return _jitterMax; };
+            void ClockResync(){ _clockResyncs++; };
+            uint32_t GetClockResyncs(){ return _clockResyncs; }; // times the master clock was stepped
+            void ClockSlew(int ppm){ if (ppm && !_clockSlewRate) _clockSlews++; _clockSlewRate = ppm; };
+            uint32_t GetClockSlews(){ return _clockSlews; }; // times the master clock started slewing
+            int GetClockSlewRate(){ return _clockSlewRate; }; // current slew in ppm
+            
+            void CountPacket(int source){ _packets[source].fetch_add(1, std::memory_order_relaxed); };
+            uint64_t GetPackets(int source){ return _packets[source]; }; // packets sent from a PacketSources entry
+            /** Add the uses of one field's lines to the rolling line usage */
+            void AddFieldLines(const std::array<uint16_t, lineCOUNT> &lines);
+            /** @return line uses over the last complete seconds, up to LINEUSAGESECONDS */
+            LineUsage GetLineUsage(int seconds);
+            static const char* GetLineUseName(LineUses use);
+            void SetUpdatedPagesQueued(int mag, int pages){ _updatedPagesQueued[mag] = pages; };
+            int GetUpdatedPagesQueued(int mag){ return _updatedPagesQueued[mag]; };
+            /** Called from the thread transmitting the magazine when a page is locked
+             *  @param page Page number 0x100 to 0x8FF
+             *  @param skipped true if the transmission is lost, false if it will be retried
+             *  @param untransmitted Fields since the page was last transmitted
+             */
+            void PageLockFailed(int page, bool skipped, int64_t untransmitted);
+            void PacketLockFailed(int mag){ _lockFailures[mag & 7]++; }; // packet 29 was locked
+            /** A page went longer untransmitted than it had before */
+            void PageGap(int page, int64_t fields);
+            uint64_t GetLockFailures(int mag){ return _lockFailures[mag]; };
+            uint64_t GetSkippedTransmissions(int mag){ return _skippedTransmissions[mag]; };
+            int64_t GetLongestGap(int mag){ return _longestGaps[mag]; }; // fields any page in the magazine went untransmitted
+            std::map<int, PageLockStats> GetPageLockStats(); // by page number
+            void PageLoad(PageLoads kind){ _pageLoads[kind]++; };
+            uint64_t GetPageLoads(PageLoads kind){ return _pageLoads[kind]; };
+            
+            LatencyHistogram* GetHistogram(Stages stage){ return &_histograms[stage]; };
+            static const char* GetStageName(Stages stage);
+            
+            /** Ask every Debug to dump its histograms. Safe to call from a signal handler. */
+            static void RequestDump(){ _dumpRequests++; };
+            /** Write the histograms to stderr if a dump has been requested since the last call */
+            void CheckDump();
             
         protected:
 
         private:
             LogLevels _debugLevel;
-            std::array<int, 8> _magDurations;
-            std::array<int, 8> _magSizes;
+            std::array<std::atomic<int>, 8> _magDurations;
+            std::array<std::atomic<int>, 8> _magSizes;
+            std::atomic<int> _outputQueue;
+            std::atomic<uint32_t> _outputUnderruns;
+            std::atomic<int> _jitterMean;
+            std::atomic<int> _jitterMax;
+            std::atomic<uint32_t> _clockResyncs;
+            std::atomic<uint32_t> _clockSlews;
+            std::atomic<int> _clockSlewRate;
+            
+            std::array<std::atomic<uint64_t>, srcCOUNT> _packets;
+            std::mutex _lineMtx; // guards the line usage
+            std::array<LineUsage, LINEUSAGESECONDS + 1> _lineSeconds; // ring of 50 field totals, including the one being filled
+            int _lineSecond; // the total being filled
+            std::array<std::atomic<int>, 8> _updatedPagesQueued;
+            std::array<std::atomic<uint64_t>, 8> _lockFailures;
+            std::array<std::atomic<uint64_t>, 8> _skippedTransmissions;
+            std::array<std::atomic<int64_t>, 8> _longestGaps;
+            std::mutex _pageLockMtx; // guards _pageLockStats
+            std::map<int, PageLockStats> _pageLockStats;
+            std::array<std::atomic<uint64_t>, loadCOUNT> _pageLoads;
+            
+            std::array<LatencyHistogram, stageCOUNT> _histograms;
+            static std::atomic<int> _dumpRequests;
+            int _dumpsDone;
     };
 }
 
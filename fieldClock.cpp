@@ -0,0 +1,196 @@
+/** FieldClock
+ */
+#include "fieldClock.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+
+#ifdef WIN32
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+#include "realtime.h"
+
+#define PCR_HZ 27000000LL
+#define PCR_FIELD (PCR_HZ / 50)
+#define PCR_WRAP (0x200000000LL * 300) // 33 bit base and 9 bit extension
+#define PCR_JUMP PCR_HZ // treat a step of more than a second as a discontinuity
+
+using namespace vbit;
+
+FieldClock::FieldClock(std::string source, Debug *debug) :
+    _source(source),
+    _debug(debug),
+    _ticks(0),
+    _tickTime(0),
+    _havePCR(false),
+    _lastPCR(0),
+    _pcrRemainder(0)
+{
+}
+
+void FieldClock::Start()
+{
+    std::thread reader(&FieldClock::_run, this);
+    reader.detach();
+}
+
+int64_t FieldClock::GetTicks(int64_t *tickTime)
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (tickTime)
+        *tickTime = _tickTime;
+    return _ticks;
+}
+
+bool FieldClock::WaitForTicks(int64_t ticks, int64_t timeout)
+{
+    std::unique_lock<std::mutex> lock(_mtx);
+    return _ticked.wait_for(lock, std::chrono::nanoseconds(timeout), [this, ticks]{ return _ticks >= ticks; });
+}
+
+void FieldClock::_tick(int64_t fields, int64_t when)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _ticks += fields;
+        _tickTime = when;
+    }
+    _ticked.notify_all();
+}
+
+void FieldClock::_parse(const std::string &line)
+{
+    int64_t now = MonotonicNanoseconds();
+    
+    if (line.empty())
+        return;
+    
+    if (line[0] == 'F')
+    {
+        _tick(1, now);
+    }
+    else if (line[0] == 'P')
+    {
+        std::istringstream ss(line.substr(1));
+        long long pcr;
+        if (!(ss >> pcr) || pcr < 0)
+        {
+            _debug->Log(Debug::LogLevels::logWARN,"[FieldClock::_parse] invalid PCR: " + line);
+            return;
+        }
+        
+        int64_t delta = pcr - _lastPCR;
+        if (delta < 0)
+            delta += PCR_WRAP;
+        
+        if (!_havePCR || delta > PCR_JUMP)
+        {
+            if (_havePCR)
+                _debug->Log(Debug::LogLevels::logWARN,"[FieldClock::_parse] PCR discontinuity");
+            _havePCR = true;
+            _lastPCR = pcr;
+            _pcrRemainder = 0;
+            return;
+        }
+        
+        _lastPCR = pcr;
+        _pcrRemainder += delta;
+        int64_t fields = _pcrRemainder / PCR_FIELD;
+        _pcrRemainder %= PCR_FIELD;
+        if (fields)
+            _tick(fields, now - _pcrRemainder * 1000 / 27); // when the last whole field was due
+    }
+    else
+    {
+        _debug->Log(Debug::LogLevels::logDEBUG,"[FieldClock::_parse] ignoring: " + line);
+    }
+}
+
+void FieldClock::_run()
+{
+    if (_source.compare(0, 4, "udp:") == 0)
+        _readUDP(std::stoi(_source.substr(4)));
+    else
+        _readFile();
+}
+
+void FieldClock::_readFile()
+{
+    while (true)
+    {
+        // opening a named pipe blocks until a writer connects
+        std::ifstream filein(_source.c_str());
+        if (!filein.is_open())
+        {
+            _debug->Log(Debug::LogLevels::logERROR,"[FieldClock::_readFile] unable to open " + _source);
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            continue;
+        }
+        
+        _debug->Log(Debug::LogLevels::logINFO,"[FieldClock::_readFile] reading field clock from " + _source);
+        
+        std::string line;
+        while (std::getline(filein, line))
+            _parse(line);
+        
+        _debug->Log(Debug::LogLevels::logWARN,"[FieldClock::_readFile] field clock closed");
+    }
+}
+
+void FieldClock::_readUDP(int port)
+{
+#ifdef WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2,2), &wsaData) != 0)
+    {
+        _debug->Log(Debug::LogLevels::logERROR,"[FieldClock::_readUDP] WSAStartup failed");
+        return;
+    }
+#endif
+    
+    int sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+    {
+        _debug->Log(Debug::LogLevels::logERROR,"[FieldClock::_readUDP] socket() failed");
+        return;
+    }
+    
+    struct sockaddr_in address;
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    
+    if (bind(sock, (struct sockaddr *) &address, sizeof(address)) < 0)
+    {
+        _debug->Log(Debug::LogLevels::logERROR,"[FieldClock::_readUDP] bind() failed on port " + std::to_string(port));
+        #ifdef WIN32
+            closesocket(sock);
+        #else
+            close(sock);
+        #endif
+        return;
+    }
+    
+    _debug->Log(Debug::LogLevels::logINFO,"[FieldClock::_readUDP] reading field clock from udp port " + std::to_string(port));
+    
+    char buffer[1500];
+    while (true)
+    {
+        int n = recv(sock, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+            continue;
+        
+        // a datagram may hold several lines
+        std::istringstream ss(std::string(buffer, n));
+        std::string line;
+        while (std::getline(ss, line))
+            _parse(line);
+    }
+}
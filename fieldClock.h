@@ -0,0 +1,63 @@
+#ifndef _FIELDCLOCK_H_
+#define _FIELDCLOCK_H_
+
+#include <cstdint>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+
+#include "debug.h"
+
+namespace vbit
+{
+    /** FieldClock follows an external field clock, so that output can be rate locked to a genlocked
+     *  inserter or a transport stream multiplexer instead of running from the local clock.
+     *  The source is a named pipe or a UDP port which receives lines of text:
+     *    F          one field has passed
+     *    P <pcr>    a 27MHz program clock reference. Fields are counted from the PCR difference.
+     *  scripts/fieldclock.py provides a stand-in clock for testing.
+     */
+    class FieldClock
+    {
+        public:
+            /** @param source A file path, or udp:<port> */
+            FieldClock(std::string source, Debug *debug);
+            
+            /** Start the thread reading the source */
+            void Start();
+            
+            /**
+             * @param tickTime If not null, set to the monotonic time in nanoseconds when the latest tick was due
+             * @return The number of field ticks received
+             */
+            int64_t GetTicks(int64_t *tickTime=nullptr);
+            
+            /** Wait until at least ticks have been received
+             *  @param timeout nanoseconds
+             *  @return false if the timeout expired
+             */
+            bool WaitForTicks(int64_t ticks, int64_t timeout);
+            
+        private:
+            void _run();
+            void _readFile();
+            void _readUDP(int port);
+            void _parse(const std::string &line);
+            void _tick(int64_t fields, int64_t when);
+            
+            std::string _source;
+            Debug* _debug;
+            
+            std::mutex _mtx;
+            std::condition_variable _ticked;
+            int64_t _ticks;
+            int64_t _tickTime;
+            
+            // reader thread only
+            bool _havePCR;
+            int64_t _lastPCR;
+            int64_t _pcrRemainder; // 27MHz cycles since the last whole field
+    };
+}
+
+#endif
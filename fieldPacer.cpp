@@ -0,0 +1,143 @@
+/** FieldPacer
+ */
+#include "fieldPacer.h"
+#include "realtime.h"
+
+#ifdef WIN32
+#include <chrono>
+#include <thread>
+#else
+#include <time.h>
+#include <cerrno>
+#endif
+
+#define FIELD_NS 20000000LL // nanoseconds per field
+#define PACER_RESTART 1000000000LL // restart timing when this far behind rather than catch up
+#define CLOCK_TIMEOUT (FIELD_NS * 3) // free run if an external tick is this late
+
+using namespace vbit;
+
+FieldPacer::FieldPacer(int linesPerField, int burst, Debug *debug, FieldClock *clock) :
+    _debug(debug),
+    _linesPerField(linesPerField),
+    _burst(burst),
+    _fieldNs(FIELD_NS),
+    _rate(0),
+    _requestedRate(0),
+    _clock(clock),
+    _tickBase(0),
+    _freeRunning(false),
+    _lostTicks(0),
+    _lateSum(0),
+    _lateMax(0),
+    _wakes(0)
+{
+    if (_burst < 1 || _burst > _linesPerField)
+        _burst = _linesPerField;
+    Reset();
+}
+
+void FieldPacer::_sleepUntil(int64_t deadline)
+{
+#ifdef WIN32
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadline)));
+#else
+    struct timespec ts;
+    ts.tv_sec = deadline / 1000000000LL;
+    ts.tv_nsec = deadline % 1000000000LL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR); // absolute, so just sleep again if interrupted
+#endif
+}
+
+void FieldPacer::Reset()
+{
+    _start = MonotonicNanoseconds();
+    _line = 0;
+    if (_clock)
+        _tickBase = _clock->GetTicks() + 1; // start on the next tick
+}
+
+int64_t FieldPacer::_externalDeadline(int64_t internal)
+{
+    int64_t field = _line / _linesPerField;
+    int64_t offset = (_line % _linesPerField) * FIELD_NS / _linesPerField; // from the start of the field
+    int64_t tickTime;
+    int64_t ticks = _clock->GetTicks(&tickTime);
+    
+    if (_freeRunning)
+    {
+        if (ticks == _lostTicks)
+            return internal;
+        
+        // ticks are back, so pick them up from this field on
+        _debug->Log(Debug::LogLevels::logINFO,"[FieldPacer::_externalDeadline] Field clock restored");
+        _freeRunning = false;
+        _tickBase = ticks - field;
+        return tickTime + offset;
+    }
+    
+    if (ticks < _tickBase + field)
+    {
+        if (!_clock->WaitForTicks(_tickBase + field, CLOCK_TIMEOUT))
+        {
+            _debug->Log(Debug::LogLevels::logWARN,"[FieldPacer::_externalDeadline] Field clock lost, free running");
+            _freeRunning = true;
+            _lostTicks = _clock->GetTicks();
+            _start = MonotonicNanoseconds() - _line * _fieldNs / _linesPerField; // carry on from now on the local clock
+            return _start + _line * _fieldNs / _linesPerField;
+        }
+        ticks = _clock->GetTicks(&tickTime);
+    }
+    
+    // if we are behind, the tick for this field came earlier than the latest one
+    return tickTime - (ticks - _tickBase - field) * FIELD_NS + offset;
+}
+
+void FieldPacer::Wait()
+{
+    if (BurstDue())
+    {
+        int rate = _requestedRate;
+        if (rate != _rate)
+        {
+            // keep this line's deadline and space the lines from here on at the new rate
+            int64_t current = _start + _line * _fieldNs / _linesPerField;
+            _rate = rate;
+            _fieldNs = FIELD_NS * 1000000 / (1000000 + _rate);
+            _start = current - _line * _fieldNs / _linesPerField;
+        }
+        
+        int64_t deadline = _start + _line * _fieldNs / _linesPerField;
+        if (_clock)
+            deadline = _externalDeadline(deadline);
+        int64_t now = MonotonicNanoseconds();
+        if (now < deadline)
+        {
+            _sleepUntil(deadline);
+            now = MonotonicNanoseconds();
+        }
+        
+        int64_t late = now - deadline;
+        if (late > PACER_RESTART)
+        {
+            _debug->Log(Debug::LogLevels::logWARN,"[FieldPacer::Wait] Output fell " + std::to_string(late / 1000000) + "ms behind, restarting timing");
+            Reset();
+            late = 0;
+        }
+        
+        _lateSum += late;
+        if (late > _lateMax)
+            _lateMax = late;
+        
+        if (++_wakes * _burst >= _linesPerField * 50)
+        {
+            // publish a second's worth of statistics
+            _debug->SetPacingJitter(_lateSum / _wakes / 1000, _lateMax / 1000);
+            _lateSum = 0;
+            _lateMax = 0;
+            _wakes = 0;
+        }
+    }
+    
+    _line++;
+}
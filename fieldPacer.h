@@ -0,0 +1,71 @@
+#ifndef _FIELDPACER_H_
+#define _FIELDPACER_H_
+
+#include <cstdint>
+#include <atomic>
+
+#include "debug.h"
+#include "fieldClock.h"
+
+namespace vbit
+{
+    /** FieldPacer releases lines at evenly spaced absolute deadlines on the monotonic clock.
+     *  Each line's deadline is worked out from the number of lines sent since timing started, so
+     *  sleeping late never accumulates as drift. Lines go out in bursts: the pacer sleeps before the
+     *  first line of each burst and lets the rest of the burst straight through.
+     *  How late each wake up is compared to its deadline is kept as jitter statistics in Debug.
+     *  With an external FieldClock each field starts on its tick instead, and the pacer only free
+     *  runs while the ticks are missing.
+     */
+    class FieldPacer
+    {
+        public:
+            /**
+             * @param linesPerField Lines in each 20ms field
+             * @param burst Lines sent at each wake up, from 1 for per line pacing to linesPerField for per field
+             * @param clock External field clock to follow, or nullptr to use the local clock
+             */
+            FieldPacer(int linesPerField, int burst, Debug *debug, FieldClock *clock=nullptr);
+            
+            /** @return true if the next line starts a burst, so output written so far should be flushed */
+            bool BurstDue(){ return _line % _burst == 0; };
+            
+            /** Wait until the next line is due */
+            void Wait();
+            
+            /** Start timing afresh from now, instead of rushing out lines to catch up after a stall */
+            void Reset();
+            
+            /** Run fast or slow to bring the master clock back into step without a jump.
+             *  Can be called from any thread. Has no effect while following an external clock.
+             *  @param ppm Parts per million faster than nominal, or negative for slower
+             */
+            void SetRate(int ppm){ _requestedRate = ppm; };
+            
+        private:
+            void _sleepUntil(int64_t deadline);
+            int64_t _externalDeadline(int64_t internal); // deadline taken from the external clock
+            
+            Debug* _debug;
+            int _linesPerField;
+            int _burst;
+            
+            int64_t _start; // when line 0 was due
+            int64_t _line; // lines released since _start
+            int64_t _fieldNs; // nanoseconds per field at the current rate
+            int _rate; // ppm
+            std::atomic<int> _requestedRate;
+            
+            FieldClock* _clock;
+            int64_t _tickBase; // external tick at which line 0 was due
+            bool _freeRunning; // external ticks have stopped
+            int64_t _lostTicks; // tick count when they stopped
+            
+            // wake up lateness over the current second
+            int64_t _lateSum;
+            int64_t _lateMax;
+            int _wakes;
+    };
+}
+
+#endif
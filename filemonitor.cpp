@@ -2,38 +2,92 @@
 
 using namespace vbit;
 
+static const int BURSTINTERVAL = 100; // ms between rescans while a burst of changes is arriving
+static const int BURSTPASSES = 50; // give up waiting for a burst to finish after this many rescans
+static const int SCANINTERVAL = 5000; // ms between scans of a quiet directory
+static const unsigned int PARSETHREADS = 8; // most threads used to parse a set of changes
+
+static File::Signature MakeSignature(const struct stat &attrib)
+{
+    File::Signature signature;
+    signature.mtime = attrib.st_mtime;
+#ifdef WIN32
+    signature.mtimeNsec = 0;
+#else
+    signature.mtimeNsec = attrib.st_mtim.tv_nsec;
+#endif
+    signature.size = attrib.st_size;
+    signature.inode = attrib.st_ino;
+    return signature;
+}
+
 File::File(std::string filename) :
     _page(new TTXPageStream()),
     _filename(filename),
-    _fileStatus(NEW)
+    _signature(),
+    _fileStatus(NEW),
+    _hash(0)
 {
     LoadFile(filename);
 }
 
 void File::LoadFile(std::string filename)
 {
-    _loaded = false;
+    std::string content;
+    ReadFile(filename, &content);
+    _hash = FNV1a(content.data(), content.size());
+    _loaded = Load(filename, content, _page);
+}
+
+std::shared_ptr<TTXPageStream> File::Parse(const std::string &content)
+{
+    std::shared_ptr<TTXPageStream> page(new TTXPageStream());
+    if (Load(_filename, content, page))
+        return page;
+    return nullptr;
+}
+
+bool File::ReadFile(std::string filename, std::string *content)
+{
+    std::ifstream filein(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!filein.is_open())
+        return false;
+    
+    filein.seekg(0, std::ios::end);
+    std::streamoff size = filein.tellg();
+    filein.seekg(0, std::ios::beg);
+    if (size < 0)
+        return false;
+    
+    content->resize(size);
+    filein.read(&(*content)[0], size);
+    content->resize(filein.gcount()); // in case the file shrank
+    return true;
+}
+
+bool File::Load(std::string filename, const std::string &content, std::shared_ptr<TTXPageStream> page)
+{
     if (filename.size() >= 4)
     {
         std::string ext = filename.substr(filename.size() - 4); // get last four characters of string
         
         if (ext == ".tti")
         {
-            _loaded = LoadTTI(filename);
+            std::istringstream filein(content);
+            return LoadTTI(filein, page);
         }
         // else other types of file we might want to load in future
     }
+    return false;
 }
 
-bool File::LoadTTI(std::string filename)
+bool File::LoadTTI(std::istream &filein, std::shared_ptr<TTXPageStream> page)
 {
-    const std::string cmd[]={"DS","SP","DE","CT","PN","SC","PS","MS","OL","FL","RD","RE","PF"};
-    const int cmdCount = 13; // There are 13 possible commands, maybe DT and RT too on really old files
+    const std::string cmd[]={"DS","SP","DE","CT","PN","SC","PS","MS","OL","FL","RD","RE","PF","PR"};
+    const int cmdCount = 14; // There are 14 possible commands, maybe DT and RT too on really old files
     unsigned int lineNumber;
     int lines=0;
-    // Open the file
-    std::ifstream filein(filename.c_str());
-    _page->ClearPage(); // reset to blank page
+    page->ClearPage(); // reset to blank page
     char * ptr;
     unsigned int subcode;
     int pageNumber = 0;
@@ -112,7 +166,7 @@ bool File::LoadTTI(std::string filename)
                                 pageNumber=(pageNumber & 0xfff00) >> 8;
                             }
                             
-                            _page->SetPageNumber(pageNumber);
+                            page->SetPageNumber(pageNumber);
                         }
                         
                         s = std::shared_ptr<Subpage>(new Subpage()); // create a new subpage
@@ -121,7 +175,7 @@ bool File::LoadTTI(std::string filename)
                         s->SetCycleTime(cycletime);
                         s->SetSubpageStatus(pagestatus);
                         s->SetRegion(region);
-                        _page->AppendSubpage(s); // add it to the page
+                        page->AppendSubpage(s); // add it to the page
 
                         break;
                     }
@@ -171,8 +225,8 @@ bool File::LoadTTI(std::string filename)
                                 triplet |= (line.at(3) & 0x3F) << 12; // first triplet contains page function and coding
                                 
                                 // Page function and coding override previous values
-                                _page->SetPageFunctionInt(triplet & 0x0F);
-                                _page->SetPageCodingInt((triplet & 0x70) >> 4);
+                                page->SetPageFunctionInt(triplet & 0x0F);
+                                page->SetPageCodingInt((triplet & 0x70) >> 4);
                             }
                         }
                         
@@ -216,11 +270,20 @@ bool File::LoadTTI(std::string filename)
                         }
                         else
                         {
-                            _page->SetPageFunctionInt(std::strtol(line.substr(0,1).c_str(), &ptr, 16));
-                            _page->SetPageCodingInt(std::strtol(line.substr(2,1).c_str(), &ptr, 16));
+                            page->SetPageFunctionInt(std::strtol(line.substr(0,1).c_str(), &ptr, 16));
+                            page->SetPageCodingInt(std::strtol(line.substr(2,1).c_str(), &ptr, 16));
                         }
                         break;
                     }
+                    case 13 : // "PR"; - not in the tti spec, page repetition within the magazine cycle
+                    {
+                        // PR,3 sends the page three times per cycle, PR,-3 sends it every third cycle
+                        std::getline(filein, line);
+                        int repeat = atoi(line.c_str());
+                        if (repeat >= -9 && repeat <= 9 && repeat != 0)
+                            page->SetRepeat(repeat);
+                        break;
+                    }
                     default:
                     {
                         // line not understood
@@ -231,21 +294,26 @@ bool File::LoadTTI(std::string filename)
         } // seek command
         if (!found) std::getline(filein, line);
     }
-    filein.close(); // Not sure that we need to close it
-    _page->RenumberSubpages();
+    page->RenumberSubpages();
     return (lines>0);
 }
 
 FileMonitor::FileMonitor(Configure *configure, Debug *debug, PageList *pageList) :
     _configure(configure),
     _debug(debug),
-    _pageList(pageList)
+    _pageList(pageList),
+    _unsettled(0),
+    _burst(false),
+    _burstPasses(0)
 {
     //ctor
 }
 
 FileMonitor::FileMonitor()
-    : _pageList(nullptr)
+    : _pageList(nullptr),
+    _unsettled(0),
+    _burst(false),
+    _burstPasses(0)
 {
     //ctor
 }
@@ -257,33 +325,90 @@ FileMonitor::~FileMonitor()
 
 void FileMonitor::run()
 {
-    std::string path=_configure->GetPageDirectory() ;
-    _debug->Log(Debug::LogLevels::logINFO,"[FileMonitor::run] Monitoring " + path);
+    _debug->Log(Debug::LogLevels::logINFO,"[FileMonitor::run] Monitoring " + _configure->GetPageDirectory());
+    Scan(true);
     
-    readDirectory(path, true);
-
     while (true)
     {
-        ClearFlags(); // Assume that no files exist
-        
-        readDirectory(path);
-        
-        // Delete pages that no longer exist (this blocks the thread until the pages are removed)
-        DeleteOldPages();
+        bool burst = Step(); // waits for this service's next field to apply any changes
+        std::this_thread::sleep_for(std::chrono::milliseconds(burst ? BURSTINTERVAL : SCANINTERVAL));
+    }
+} // run
 
-        // Wait 5 seconds to avoid hogging cpu
-        // Sounds like a job for a mutex.
-        struct timespec rec;
-        int ms;
+void FileMonitor::Scan(bool firstrun)
+{
+    std::vector<Change> changes;
+    
+    ClearFlags(); // Assume that no files exist
+    readDirectory(_configure->GetPageDirectory(), &changes, firstrun);
+    
+    Apply(&changes, firstrun);
+}
+
+bool FileMonitor::Step()
+{
+    std::vector<Change> changes;
+    
+    ClearFlags(); // Assume that no files exist
+    readDirectory(_configure->GetPageDirectory(), &changes);
+    
+    if (!_burst)
+    {
+        if (!(changes.empty() && _unsettled == 0))
+        {
+            // A bulk update (e.g. git pull) changes many files over a short time.
+            // Keep rescanning until the directory goes quiet and every file has settled so that the whole burst is applied as one set.
+            _burst = true;
+            _burstPasses = 0;
+            _burstChanges.swap(changes);
+            return true;
+        }
+    }
+    else
+    {
+        bool quiet = _unsettled == 0 && changes.size() == _burstChanges.size();
+        for (unsigned int i=0; quiet && i<changes.size(); i++)
+            quiet = changes[i].filename == _burstChanges[i].filename && changes[i].signature == _burstChanges[i].signature;
+        
+        _burstChanges.clear();
+        if (!quiet && ++_burstPasses < BURSTPASSES)
+        {
+            _burstChanges.swap(changes);
+            return true;
+        }
+        _burst = false; // files still being written are picked up by a later scan
+    }
+    
+    Apply(&changes, false);
+    return false;
+}
 
-        ms=5000;
-        rec.tv_sec = ms / 1000;
-        rec.tv_nsec=(ms % 1000) *1000000;
-        nanosleep(&rec,nullptr);
+void FileMonitor::Apply(std::vector<Change> *changes, bool firstrun)
+{
+    bool deletions = false;
+    for (std::list<std::shared_ptr<File>>::iterator p=_FilesList.begin();p!=_FilesList.end();++p)
+    {
+        if ((*p)->GetStatusFlag()==File::NOTFOUND)
+            deletions = true;
     }
-} // run
+    
+    if (changes->empty() && !deletions)
+        return; // nothing to do
+    
+    ParseChanges(changes); // the slow part is done before the service is held up
+    
+    // apply the whole set between two fields so that viewers never see a half updated service
+    _pageList->RunAtFieldBoundary([this, changes, firstrun]()
+    {
+        ApplyChanges(changes, firstrun);
+        DeleteOldPages(); // Delete pages that no longer exist
+    });
+    
+    if (changes->size() > 1 && !firstrun)
+        _debug->Log(Debug::LogLevels::logINFO,"[FileMonitor::Apply] Applied " + std::to_string(changes->size()) + " changed pages");
+}
 
-int FileMonitor::readDirectory(std::string path, bool firstrun)
+int FileMonitor::readDirectory(std::string path, std::vector<Change> *changes, bool firstrun)
 {
     struct dirent *dirp;
     struct stat attrib;
@@ -297,9 +422,20 @@ int FileMonitor::readDirectory(std::string path, bool firstrun)
         return errno;
     }
     
+    bool top = path == _configure->GetPageDirectory();
+    if (top)
+    {
+        for (std::map<std::string, Pending>::iterator it=_pending.begin(); it!=_pending.end(); ++it)
+            it->second.seen = false;
+        _unsettled = 0;
+    }
+    
     // Load the filenames into a list
     while ((dirp = readdir(dp)) != NULL)
     {
+        if (dirp->d_name[0] == '.')
+            continue; // ignore anything beginning with . including editor and rsync temporary files
+        
         std::string name;
         name=path;
         name+="/";
@@ -310,12 +446,9 @@ int FileMonitor::readDirectory(std::string path, bool firstrun)
         if (attrib.st_mode & S_IFDIR)
         {
             // directory entry is another directory
-            if (dirp->d_name[0] != '.') // ignore anything beginning with .
+            if (readDirectory(name, changes, firstrun)) // recurse into directory
             {
-                if (readDirectory(name)) // recurse into directory
-                {
-                    _debug->Log(Debug::LogLevels::logERROR,"Error(" + std::to_string(errno) + ") recursing into " + name);
-                }
+                _debug->Log(Debug::LogLevels::logERROR,"Error(" + std::to_string(errno) + ") recursing into " + name);
             }
             continue;
         }
@@ -327,110 +460,248 @@ int FileMonitor::readDirectory(std::string path, bool firstrun)
             if (find(filetypes.begin(), filetypes.end(), ext) != filetypes.end())
             {
                 // Now we want to process changes
-                // 1) Is it a new page? Then add it.
+                Change change = {name, MakeSignature(attrib), nullptr, nullptr, false, 0, false};
                 std::shared_ptr<File> f = Locate(name);
                 if (f) // File was found
                 {
                     f->SetState(File::FOUND); // Mark this page as existing on the drive
-                    std::shared_ptr<TTXPageStream> page = f->GetPage();
-                    if (attrib.st_mtime!=f->GetModifiedTime()) // File exists. Has it changed?
+                    if (change.signature!=f->GetSignature()) // File exists. Has it changed?
                     {
-                        if (page->GetIsMarked()) // file is mid-deletion
+                        if (f->GetPage()->GetIsMarked()) // file is mid-deletion
                         {
                             f->SetState(File::NOTFOUND); // let this file object get deleted and reloaded
                         }
-                        else
+                        else if (firstrun || Settled(name, change.signature)) // don't load a file which is still being written
                         {
-                            // We just load the new page and update the modified time
-                            if (page->GetLock()) // try to lock page
-                            {
-                                int curnum = page->GetPageNumber();
-                                f->LoadFile(name);
-                                if (page->GetPageNumber() != curnum)
-                                {
-                                    // page number changed
-                                    page->MarkForDeletion(); // mark page for deletion from service
-                                    f->SetState(File::NOTFOUND); // let this file object get deleted and reloaded
-                                }
-                                else
-                                {
-                                    if (f->Loaded())
-                                    {
-                                        if (page->GetOneShotFlag())
-                                        {
-                                            // file load clears oneshot status
-                                            page->SetOneShotFlag(false);
-                                            _debug->Log(Debug::LogLevels::logINFO,"[FileMonitor::run] Reloading page from " + std::string(dirp->d_name));
-                                        }
-                                        
-                                        page->IncrementUpdateCount();
-                                        int update = false;
-                                        
-                                        page->StepFirstSubpage(); // Only check update flag on first subpage. Carousels don't get pushed out anyway
-                                        if (std::shared_ptr<Subpage> s = page->GetSubpage())
-                                            update = (s->GetSubpageStatus() & PAGESTATUS_C8_UPDATE);
-                                        
-                                        if (!(_pageList->Contains(page)))
-                                        {
-                                            // this page is not currently in pagelist
-                                            _pageList->AddPage(page, !update); // only transmit immediate update if update flag is set
-                                        }
-                                        else
-                                        {
-                                            _pageList->UpdatePageLists(page, !update); // only transmit immediate update if update flag is set
-                                        }
-                                        
-                                        page->StepLastSubpage(); // prepare for page to roll to first subpage
-                                    }
-                                    else
-                                    {
-                                        _debug->Log(Debug::LogLevels::logWARN,"[FileMonitor::run] Failed to load " + std::string(dirp->d_name));
-                                        page->MarkForDeletion(); // mark page for deletion from service
-                                    }
-                                    
-                                    _pageList->CheckForPacket29OrCustomHeader(page);
-                                    
-                                    f->SetModifiedTime(attrib.st_mtime);
-                                }
-                                page->FreeLock(); // must unlock or everything will grind to a halt
-                            }
+                            change.file = f;
+                            changes->push_back(change);
                         }
                     }
                 }
-                else
+                else if (firstrun || Settled(name, change.signature))
                 {
-                    if (!firstrun){ // suppress logspam on first run
-                        _debug->Log(Debug::LogLevels::logINFO,"[FileMonitor::run] Adding a new page " + std::string(dirp->d_name));
-                    }
-                    // A new file. Create the page object and add it to the page list.
-                    
-                    std::shared_ptr<File> f(new File(name));
-                    f->SetModifiedTime(attrib.st_mtime); // set timestamp
-                    if (f->Loaded())
-                    {
-                        std::shared_ptr<TTXPageStream> page = f->GetPage();
-                        
-                        // don't add to updated pages list if this is the initial startup
-                        int update = false;
-                        if (std::shared_ptr<Subpage> s = page->GetSubpage())
-                            update = (s->GetSubpageStatus() & PAGESTATUS_C8_UPDATE) && !page->IsCarousel(); // only check update flag of single subpages
-                        _pageList->AddPage(page, firstrun | !update); // only transmit immediate update if update flag is set and vbit2 isn't starting up
-                        _pageList->CheckForPacket29OrCustomHeader(page);
-                    }
-                    else
-                    {
-                        _debug->Log(Debug::LogLevels::logWARN,"[FileMonitor::run] Failed to load " + std::string(dirp->d_name));
-                    }
-                    _FilesList.push_back(f);
+                    // A new file
+                    change.added = true;
+                    changes->push_back(change);
                 }
             }
         }
     }
     closedir(dp);
     
+    if (top)
+    {
+        // forget files which were deleted or have been applied
+        for (std::map<std::string, Pending>::iterator it=_pending.begin(); it!=_pending.end();)
+        {
+            if (it->second.seen)
+                ++it;
+            else
+                it = _pending.erase(it);
+        }
+    }
+    
     return 0;
 }
 
+bool FileMonitor::Settled(std::string filename, File::Signature signature)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::chrono::milliseconds settle(_configure->GetFileSettleTime());
+    
+    std::map<std::string, Pending>::iterator it = _pending.find(filename);
+    if (it == _pending.end() || it->second.signature != signature)
+    {
+        // first sight of this version of the file. Further changes restart the wait so that they are coalesced.
+        Pending pending = {signature, now, false, false};
+        it = _pending.insert(std::make_pair(filename, pending)).first;
+        it->second = pending;
+    }
+    it->second.seen = true;
+    
+    if (!it->second.settled)
+    {
+        // a file last modified longer ago than the settle time is complete, e.g. one written elsewhere and renamed into place
+        auto age = std::chrono::system_clock::now() - std::chrono::system_clock::from_time_t(signature.mtime) - std::chrono::nanoseconds(signature.mtimeNsec);
+        
+        it->second.settled = age >= settle || now - it->second.since >= settle;
+        if (!it->second.settled)
+            _unsettled++;
+    }
+    
+    return it->second.settled;
+}
+
+void FileMonitor::ParseChanges(std::vector<Change> *changes)
+{
+    std::atomic<std::size_t> next(0);
+    
+    LatencyHistogram *parseTimes = _debug->GetHistogram(Debug::stagePARSE);
+    
+    auto worker = [changes, &next, parseTimes]()
+    {
+        for (std::size_t i = next++; i < changes->size(); i = next++)
+        {
+            Change &change = (*changes)[i];
+            StageTimer timer(parseTimes);
+            if (change.added)
+            {
+                change.file = std::shared_ptr<File>(new File(change.filename)); // loads the file
+                continue;
+            }
+            
+            std::string content;
+            File::ReadFile(change.filename, &content);
+            change.hash = FNV1a(content.data(), content.size());
+            
+            // a file rewritten with the same contents needs no parse. A one shot page is always reloaded to clear it.
+            change.unchanged = change.hash == change.file->GetHash() && !change.file->GetPage()->GetOneShotFlag();
+            if (!change.unchanged)
+                change.page = change.file->Parse(content);
+        }
+    };
+    
+    unsigned int threads = std::thread::hardware_concurrency();
+    if (threads > PARSETHREADS)
+        threads = PARSETHREADS;
+    if (threads > changes->size())
+        threads = changes->size();
+    
+    std::vector<std::thread> workers;
+    for (unsigned int i=1; i<threads; i++)
+        workers.push_back(std::thread(worker));
+    worker(); // this thread does its share too
+    for (unsigned int i=0; i<workers.size(); i++)
+        workers[i].join();
+}
+
+void FileMonitor::ApplyChanges(std::vector<Change> *changes, bool firstrun)
+{
+    // This is called from the Service thread (see PageList::RunAtFieldBoundary)
+    for (std::vector<Change>::iterator it=changes->begin(); it!=changes->end(); ++it)
+    {
+        std::shared_ptr<File> f = it->file;
+        std::string filename = f->GetFilename().substr(_configure->GetPageDirectory().length() + 1);
+        
+        if (it->added)
+        {
+            if (!firstrun){ // suppress logspam on first run
+                _debug->Log(Debug::LogLevels::logINFO,"[FileMonitor::ApplyChanges] Adding a new page " + filename);
+            }
+            
+            f->SetSignature(it->signature); // set timestamp
+            f->SetState(File::FOUND);
+            if (f->Loaded())
+            {
+                AddNewPage(f->GetPage(), firstrun);
+                _debug->PageLoad(Debug::loadADDED);
+            }
+            else
+            {
+                _debug->Log(Debug::LogLevels::logWARN,"[FileMonitor::ApplyChanges] Failed to load " + filename);
+                _debug->PageLoad(Debug::loadFAILED);
+            }
+            _FilesList.push_back(f);
+            continue;
+        }
+        
+        if (it->unchanged)
+        {
+            f->SetSignature(it->signature); // nothing else to do
+            continue;
+        }
+        
+        std::shared_ptr<TTXPageStream> page = f->GetPage();
+        int mag = (page->GetPageNumber() >> 8) & 7;
+        
+        // a magazine part way through sending the page holds its lock, but it runs on this thread and sends the rest of the old subpage
+        bool locked = page->GetLock();
+        if (!locked && !_pageList->GetMagazines()[mag]->IsSending(page))
+            continue; // held by another thread so leave the signature alone and try again next scan
+        
+        if (it->page == nullptr)
+        {
+            _debug->Log(Debug::LogLevels::logWARN,"[FileMonitor::ApplyChanges] Failed to load " + filename);
+            _debug->PageLoad(Debug::loadFAILED);
+            page->MarkForDeletion(); // mark page for deletion from service
+            Delete29AndHeader(page);
+        }
+        else if (it->page->GetPageNumber() != page->GetPageNumber())
+        {
+            // page number changed
+            page->MarkForDeletion(); // mark old page for deletion from service
+            Delete29AndHeader(page);
+            f->SetPage(it->page);
+            AddNewPage(it->page, false);
+            _debug->PageLoad(Debug::loadRELOADED);
+        }
+        else if (it->page->ReuseSubpages(*page) == 0 && it->page->GetSubpageCount() == page->GetSubpageCount() &&
+                 it->page->GetPageCoding() == page->GetPageCoding() && it->page->GetPageFunction() == page->GetPageFunction() &&
+                 it->page->GetRepeat() == page->GetRepeat() && !page->GetOneShotFlag())
+        {
+            // file changed but none of the page content did, e.g. a DE line
+            _debug->Log(Debug::LogLevels::logDEBUG,"[FileMonitor::ApplyChanges] Content unchanged " + filename);
+            _debug->PageLoad(Debug::loadUNCHANGED);
+        }
+        else
+        {
+            // carousels carry on from the current subpage if it still exists so that their timing isn't upset
+            bool carousel = page->IsCarousel();
+            std::shared_ptr<Subpage> current = page->GetSubpage();
+            
+            page->ReplaceContent(*(it->page)); // subpages and rows which didn't change are kept
+            _debug->Log(Debug::LogLevels::logDEBUG,"[FileMonitor::ApplyChanges] Reloaded " + filename);
+            _debug->PageLoad(Debug::loadRELOADED);
+            
+            if (page->GetOneShotFlag())
+            {
+                // file load clears oneshot status
+                page->SetOneShotFlag(false);
+                _debug->Log(Debug::LogLevels::logINFO,"[FileMonitor::ApplyChanges] Reloading page from " + filename);
+            }
+            
+            page->IncrementUpdateCount();
+            int update = false;
+            
+            page->StepFirstSubpage(); // Only check update flag on first subpage. Carousels don't get pushed out anyway
+            if (std::shared_ptr<Subpage> s = page->GetSubpage())
+                update = (s->GetSubpageStatus() & PAGESTATUS_C8_UPDATE);
+            
+            if (!(_pageList->Contains(page)))
+            {
+                // this page is not currently in pagelist
+                _pageList->AddPage(page, !update); // only transmit immediate update if update flag is set
+            }
+            else
+            {
+                _pageList->UpdatePageLists(page, !update); // only transmit immediate update if update flag is set
+            }
+            
+            if (carousel && current && page->IsCarousel() && page->LocateSubpage(current->GetSubCode()))
+                page->SetSubpage(current->GetSubCode()); // stay on the same subpage until its time is up
+            else
+                page->StepLastSubpage(); // prepare for page to roll to first subpage
+            
+            _pageList->CheckForPacket29OrCustomHeader(page);
+        }
+        
+        f->SetSignature(it->signature);
+        f->SetHash(it->hash);
+        
+        if (locked)
+            page->FreeLock(); // must unlock or everything will grind to a halt
+    }
+}
+
+void FileMonitor::AddNewPage(std::shared_ptr<TTXPageStream> page, bool firstrun)
+{
+    // don't add to updated pages list if this is the initial startup
+    int update = false;
+    if (std::shared_ptr<Subpage> s = page->GetSubpage())
+        update = (s->GetSubpageStatus() & PAGESTATUS_C8_UPDATE) && !page->IsCarousel(); // only check update flag of single subpages
+    _pageList->AddPage(page, firstrun | !update); // only transmit immediate update if update flag is set and vbit2 isn't starting up
+    _pageList->CheckForPacket29OrCustomHeader(page);
+}
 
 // Find a file by filename
 std::shared_ptr<File> FileMonitor::Locate(std::string filename)
@@ -4,15 +4,20 @@
 #include <iostream>
 #include <sstream>
 #include <thread>
+#include <chrono>
+#include <atomic>
 #include <list>
 #include <strings.h>
 #include <sys/stat.h>
 #include <array>
+#include <vector>
+#include <map>
 
 #include "configure.h"
 #include "pagelist.h"
 #include "packetmag.h"
 #include "ttxpagestream.h"
+#include "hash.h"
 
 namespace vbit
 {
@@ -28,10 +33,24 @@ namespace vbit
             
             File(std::string filename);
             std::shared_ptr<TTXPageStream> GetPage(){return _page;};
+            void SetPage(std::shared_ptr<TTXPageStream> page){_page=page;};
             
-            // The time that the file was modified.
-            time_t GetModifiedTime(){return _modifiedTime;};
-            void SetModifiedTime(time_t timeVal){_modifiedTime=timeVal;};
+            /** What identifies a version of the file on disk.
+             *  The inode changes when a new version is renamed into place, even if the modified time doesn't.
+             */
+            struct Signature
+            {
+                time_t mtime;
+                long mtimeNsec;
+                off_t size;
+                ino_t inode;
+                bool operator==(const Signature &rhs) const {return mtime==rhs.mtime && mtimeNsec==rhs.mtimeNsec && size==rhs.size && inode==rhs.inode;};
+                bool operator!=(const Signature &rhs) const {return !(*this == rhs);};
+            };
+            
+            // The signature of the file when it was loaded. (Used to detect updates)
+            Signature GetSignature(){return _signature;};
+            void SetSignature(Signature signature){_signature=signature;};
             
             void SetState(Status state){_fileStatus=state;};
             Status GetStatusFlag(){return _fileStatus;};
@@ -41,12 +60,29 @@ namespace vbit
             void LoadFile(std::string filename);
             bool Loaded(){return _loaded;}
             
+            /** Load the file into a new page, leaving the page on air untouched
+             *  @param content the contents of the file
+             *  @return the new page, or nullptr if the file could not be loaded
+             */
+            std::shared_ptr<TTXPageStream> Parse(const std::string &content);
+            
+            /** Read the whole of a file
+             *  @return false if the file could not be opened
+             */
+            static bool ReadFile(std::string filename, std::string *content);
+            
+            // hash of the file contents when it was loaded. (Used to skip reloading unchanged files)
+            uint64_t GetHash(){return _hash;};
+            void SetHash(uint64_t hash){_hash=hash;};
+            
         private:
             std::shared_ptr<TTXPageStream> _page; // the page loaded from this file
             std::string _filename;
-            time_t _modifiedTime;   /// Poll this in case the source file changes (Used to detect updates)
+            Signature _signature;   /// Poll this in case the source file changes (Used to detect updates)
             Status _fileStatus; /// Used to mark if we found the file. (Used to detect deletions)
-            bool LoadTTI(std::string filename);
+            uint64_t _hash;
+            bool Load(std::string filename, const std::string &content, std::shared_ptr<TTXPageStream> page);
+            bool LoadTTI(std::istream &filein, std::shared_ptr<TTXPageStream> page);
             bool _loaded;
     };
     
@@ -64,9 +100,21 @@ namespace vbit
 
             /**
              * Runs the monitoring thread and does not terminate (at least for now)
-             * @return Nothing useful yet. Perhaps return an error status if something goes wrong
+             * Each service has its own, so a service which stalls doesn't hold up page changes in the others.
              */
             void run();
+            
+            /**
+             * Scan the page directory once, loading new and changed pages
+             * @param firstrun - true for the initial load when starting up
+             */
+            void Scan(bool firstrun=false);
+            
+            /**
+             * Scan the page directory, or rescan it while waiting for a burst of changes to settle, then apply any changes
+             * @return true while a burst is settling, so the next step is due after a short interval
+             */
+            bool Step();
 
         protected:
 
@@ -75,7 +123,39 @@ namespace vbit
             Debug* _debug;
             PageList* _pageList;
             std::list<std::shared_ptr<File>> _FilesList;
-            int readDirectory(std::string path, bool firstrun=false);
+            
+            /** A new or modified file found by a scan */
+            struct Change
+            {
+                std::string filename;
+                File::Signature signature;
+                std::shared_ptr<File> file; // nullptr for a new file until it has been parsed
+                std::shared_ptr<TTXPageStream> page; // freshly parsed content for a modified file
+                bool added; // a new file
+                uint64_t hash; // hash of the new contents
+                bool unchanged; // contents are the same as when the file was last loaded
+            };
+            
+            /** A file seen to change, which is left alone until it has stopped changing for the settle time */
+            struct Pending
+            {
+                File::Signature signature;
+                std::chrono::steady_clock::time_point since; // when the file was first seen with this signature
+                bool seen; // seen on this pass of the directory
+                bool settled; // waiting to be applied
+            };
+            std::map<std::string, Pending> _pending; // keyed on filename
+            int _unsettled; // pending files which are still being written
+            bool _burst; // a burst of changes is settling
+            int _burstPasses; // rescans of the burst so far
+            std::vector<Change> _burstChanges; // changes found by the last scan of the burst
+            
+            int readDirectory(std::string path, std::vector<Change> *changes, bool firstrun=false);
+            bool Settled(std::string filename, File::Signature signature);
+            void Apply(std::vector<Change> *changes, bool firstrun);
+            void ParseChanges(std::vector<Change> *changes);
+            void ApplyChanges(std::vector<Change> *changes, bool firstrun);
+            void AddNewPage(std::shared_ptr<TTXPageStream> page, bool firstrun);
             
             std::shared_ptr<File> Locate(std::string filename);
             void ClearFlags();
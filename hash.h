@@ -0,0 +1,27 @@
+#ifndef _HASH_H_
+#define _HASH_H_
+
+#include <cstdint>
+#include <cstddef>
+
+namespace vbit
+{
+    static const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+    static const uint64_t FNV_PRIME = 0x100000001b3ULL;
+    
+    /** FNV-1a 64 bit hash, used to spot content which hasn't changed
+     *  @param hash the result of a previous call to continue hashing more data
+     */
+    inline uint64_t FNV1a(const void *data, std::size_t length, uint64_t hash=FNV_OFFSET_BASIS)
+    {
+        const uint8_t *p = static_cast<const uint8_t*>(data);
+        for (std::size_t i=0; i<length; i++)
+        {
+            hash ^= p[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+}
+
+#endif // _HASH_H_
@@ -29,9 +29,11 @@ InterfaceServer::InterfaceServer(Configure *configure, Debug *debug, PageList *p
     _configure(configure),
     _debug(debug),
     _pageList(pageList),
+    _predictor(configure, pageList),
     _portNumber(configure->GetInterfaceServerPort()),
     _maxClients(configure->GetInterfaceServerMaxClients()),
-    _isActive(false)
+    _isActive(false),
+    _clientCount(0)
 {
     /* initialise sockets */
     _serverSock = -1;
@@ -82,7 +84,9 @@ void InterfaceServer::CloseClient(ClientState *client)
     
     if (client->page)
     {
+        client->page->UpdateSubtitleFlag();
         client->page->FreeLock(); // unlock page
+        _pageList->PagesChanged();
     }
 }
 
@@ -158,6 +162,7 @@ void InterfaceServer::run()
                 FD_SET((*it).socket , &readfds);
         }
         _isActive = !(_clients.empty());
+        _clientCount = _clients.size();
         
         /* wait for activity on any socket */
         if ((select(FD_SETSIZE, &readfds, NULL, NULL, NULL) < 0) && (errno!=EINTR))
@@ -227,6 +232,8 @@ void InterfaceServer::run()
                             n = recv(client->socket, readBuffer, len, 0); // try to read whole message
                             if (n == len)
                             {
+                                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(); // time the command handling
+                                
                                 std::vector<uint8_t> res;
                                 res.push_back(CMDOK); // create "OK" response
                                 
@@ -582,6 +589,96 @@ void InterfaceServer::run()
                                                     break;
                                                 }
                                                 
+                                                case CONFPREDICT:
+                                                {
+                                                    if (n == 3)
+                                                    {
+                                                        std::array<CyclePredictor::Prediction, 8> prediction = _predictor.Predict();
+                                                        std::array<int,8> measured = _debug->GetMagCycleDurations();
+                                                        for (int mag = 0; mag < 8; mag++)
+                                                        {
+                                                            int pages = std::min(prediction[mag].pages, 0xffff);
+                                                            int fields = std::min(prediction[mag].fields, 0xffff);
+                                                            int actual = std::min(measured[mag], 0xffff);
+                                                            res.push_back(pages >> 8);
+                                                            res.push_back(pages & 0xff);
+                                                            res.push_back(fields >> 8);
+                                                            res.push_back(fields & 0xff);
+                                                            res.push_back(actual >> 8);
+                                                            res.push_back(actual & 0xff);
+                                                        }
+                                                    }
+                                                    else
+                                                    {
+                                                        res[0] = CMDERR;
+                                                    }
+                                                    break;
+                                                }
+                                                
+                                                case CONFOUTPUT:
+                                                {
+                                                    if (n == 3)
+                                                    {
+                                                        int queued = std::min(_debug->GetOutputQueue(), 0xffff);
+                                                        uint32_t underruns = _debug->GetOutputUnderruns();
+                                                        res.push_back(_configure->GetOutputLookahead());
+                                                        res.push_back(queued >> 8);
+                                                        res.push_back(queued & 0xff);
+                                                        res.push_back(underruns >> 24);
+                                                        res.push_back((underruns >> 16) & 0xff);
+                                                        res.push_back((underruns >> 8) & 0xff);
+                                                        res.push_back(underruns & 0xff);
+                                                        int jitterMean = std::min(_debug->GetPacingJitterMean(), 0xffff);
+                                                        int jitterMax = std::min(_debug->GetPacingJitterMax(), 0xffff);
+                                                        res.push_back(jitterMean >> 8);
+                                                        res.push_back(jitterMean & 0xff);
+                                                        res.push_back(jitterMax >> 8);
+                                                        res.push_back(jitterMax & 0xff);
+                                                        int resyncs = std::min(_debug->GetClockResyncs(), (uint32_t)0xffff);
+                                                        int slews = std::min(_debug->GetClockSlews(), (uint32_t)0xffff);
+                                                        int16_t slewRate = _debug->GetClockSlewRate();
+                                                        res.push_back(resyncs >> 8);
+                                                        res.push_back(resyncs & 0xff);
+                                                        res.push_back(slews >> 8);
+                                                        res.push_back(slews & 0xff);
+                                                        res.push_back((uint16_t)slewRate >> 8);
+                                                        res.push_back((uint16_t)slewRate & 0xff);
+                                                    }
+                                                    else
+                                                    {
+                                                        res[0] = CMDERR;
+                                                    }
+                                                    break;
+                                                }
+                                                
+                                                case CONFSTATS:
+                                                {
+                                                    if (n == 3 || (n == 4 && readBuffer[3] <= 1))
+                                                    {
+                                                        res.push_back(Debug::stageCOUNT);
+                                                        for (int i = 0; i < Debug::stageCOUNT; i++)
+                                                        {
+                                                            LatencyHistogram *h = _debug->GetHistogram((Debug::Stages)i);
+                                                            uint64_t values[5] = {h->GetCount(), h->GetPercentile(0.5), h->GetPercentile(0.99), h->GetPercentile(0.999), h->GetMax()};
+                                                            for (int v = 0; v < 5; v++)
+                                                            {
+                                                                uint32_t value = std::min(values[v], (uint64_t)0xffffffff);
+                                                                res.push_back(value >> 24);
+                                                                res.push_back((value >> 16) & 0xff);
+                                                                res.push_back((value >> 8) & 0xff);
+                                                                res.push_back(value & 0xff);
+                                                            }
+                                                            if (n == 4 && readBuffer[3] == 1)
+                                                                h->Reset(); // start a new measurement
+                                                        }
+                                                    }
+                                                    else
+                                                    {
+                                                        res[0] = CMDERR;
+                                                    }
+                                                    break;
+                                                }
+                                                
                                                 default: // unknown configuration command
                                                     res[0] = CMDERR;
                                             }
@@ -606,7 +703,9 @@ void InterfaceServer::run()
                                                 if (cmd <= PAGEOPEN && client->page)
                                                 {
                                                     // implicitly close page when issuing other page delete/open commands
+                                                    client->page->UpdateSubtitleFlag();
                                                     client->page->FreeLock();
+                                                    _pageList->PagesChanged();
                                                     client->page = nullptr;
                                                     client->subpage = nullptr;
                                                 }
@@ -660,7 +759,7 @@ void InterfaceServer::run()
                                                                     {
                                                                         p->SetPageNumber(num);
                                                                         p->SetOneShotFlag(OneShot);
-                                                                        _pageList->AddPage(p, true); // put it in the page lists
+                                                                        _pageList->RunAtFieldBoundary([this, p]{ _pageList->AddPage(p, true); }); // put it in the page lists between fields
                                                                         
                                                                         // at this stage it has no subpages!
                                                                         client->page = p;
@@ -760,7 +859,11 @@ void InterfaceServer::run()
                                                 if (n==3)
                                                 {
                                                     if (client->page)
+                                                    {
+                                                        client->page->UpdateSubtitleFlag(); // PAGEOPTNS may have changed it
                                                         client->page->FreeLock();
+                                                        _pageList->PagesChanged();
+                                                    }
                                                     else
                                                         res[0] = CMDNOENT;
                                                     client->page = nullptr;
@@ -951,7 +1054,34 @@ void InterfaceServer::run()
                                                     res[0] = CMDERR;
                                                 }
                                             }
-                                            else if (cmd > PAGELINKS) // last defined command number
+                                            else if (cmd == PAGEREPEAT)
+                                            {
+                                                if (client->page)
+                                                {
+                                                    std::stringstream ss;
+                                                    ss << "[InterfaceServer::run] Client " << std::string(inet_ntoa(address.sin_addr)) << ":" << std::to_string(ntohs(address.sin_port)) << ": PAGEREPEAT";
+                                                    _debug->Log(Debug::LogLevels::logDEBUG,ss.str());
+                                                    
+                                                    if (n == 4) // write
+                                                    {
+                                                        int repeat = (int8_t)readBuffer[3];
+                                                        if (repeat >= -9 && repeat <= 9 && repeat != 0)
+                                                            client->page->SetRepeat(repeat);
+                                                        else
+                                                            res[0] = CMDERR;
+                                                    }
+                                                    else if (n != 3)
+                                                    {
+                                                        res[0] = CMDERR;
+                                                    }
+                                                    res.push_back((uint8_t)client->page->GetRepeat());
+                                                }
+                                                else
+                                                {
+                                                    res[0] = CMDERR;
+                                                }
+                                            }
+                                            else if (cmd > PAGEREPEAT) // last defined command number
                                             {
                                                 std::stringstream ss;
                                                 ss << "[InterfaceServer::run] Client " << std::string(inet_ntoa(address.sin_addr)) << ":" << std::to_string(ntohs(address.sin_port)) << ": Unknown PAGESAPI command received " << std::hex << cmd;
@@ -976,6 +1106,8 @@ void InterfaceServer::run()
                                 
                                 res.insert(res.begin(), res.size()+1); // prepend message size
                                 
+                                _debug->GetHistogram(Debug::stageINTERFACE)->Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+                                
                                 unsigned int n = send(client->socket, (char*)res.data(), res.size(), 0); // send response
                                 
                                 if (n == res.size()) // fail if only partial response can be sent
@@ -8,6 +8,7 @@
 #include "ttxpagestream.h"
 #include "packet.h"
 #include "packetDatacast.h"
+#include "cyclePredictor.h"
 
 #ifdef WIN32
 #include <winsock2.h>
@@ -44,6 +45,9 @@
 #define CONFSTATUS  0x02    /* get/set 20 byte BSDP status message */
 #define CONFHEADER  0x03    /* get/set 32 byte header template */
 #define CONFENHANC  0x04    /* Get/Set/Delete magazine enhancements */
+#define CONFPREDICT 0x05    /* Get predicted and measured magazine cycle times */
+#define CONFOUTPUT  0x06    /* Get output queue occupancy and timing */
+#define CONFSTATS   0x07    /* Get and reset stage latency histograms */
 
 /* command numbers for page data API */
 #define PAGEDELETE  0x00    /* remove a page from the service */
@@ -55,6 +59,7 @@
 #define PAGEOPTNS   0x06    /* get/set subpage options */
 #define PAGEROW     0x07    /* read/write/delete subpage row data */
 #define PAGELINKS   0x08    /* get/set fastext link values */
+#define PAGEREPEAT  0x09    /* get/set page repetition */
 
 namespace vbit
 
@@ -75,17 +80,19 @@ namespace vbit
             
             void run();
             bool GetIsActive(){return _isActive;}; /* is interface server in use? */
+            int GetClientCount(){return _clientCount;}; /* connected clients */
             
             
             PacketDatacast** GetDatachannels() { PacketDatacast **channels=_datachannel; return channels; };
             
         private:
-            const uint8_t APIVERSION[3] = {1,1,0}; // Version number for interface API.
+            const uint8_t APIVERSION[3] = {1,2,0}; // Version number for interface API.
             
             Configure* _configure;
             Debug* _debug;
             PageList* _pageList;
             PacketDatacast* _datachannel[16]; /* array of datacast sources */
+            CyclePredictor _predictor;
             
             static const uint16_t MAXPENDING=5;
             
@@ -96,6 +103,7 @@ namespace vbit
             uint16_t _maxClients;
             
             bool _isActive;
+            std::atomic<int> _clientCount;
             
             void SocketError(std::string errorMessage); // handle fatal socket errors
             void CloseClient(ClientState *client); // clean up after a connected client
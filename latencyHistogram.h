@@ -0,0 +1,126 @@
+#ifndef _LATENCYHISTOGRAM_H_
+#define _LATENCYHISTOGRAM_H_
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace vbit
+{
+    /** A histogram of durations with buckets an eighth of a power of two wide, so any value is
+     *  recorded to within 12.5% from nanoseconds up to seconds in a fixed 2KB.
+     *  Recording is lock free and may be done from any number of threads.
+     */
+    class LatencyHistogram
+    {
+        public:
+            static const int SUB_BITS = 3;
+            static const int SUB_BUCKETS = 1 << SUB_BITS;
+            static const int BUCKETS = (35 - SUB_BITS + 1) * SUB_BUCKETS; // up to 2^35ns, about 34 seconds
+
+            LatencyHistogram() { Reset(); }
+
+            void Record(uint64_t ns)
+            {
+                _buckets[_bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+                _count.fetch_add(1, std::memory_order_relaxed);
+                _sum.fetch_add(ns, std::memory_order_relaxed);
+                uint64_t max = _max.load(std::memory_order_relaxed);
+                while (ns > max && !_max.compare_exchange_weak(max, ns, std::memory_order_relaxed));
+            }
+
+            /** Not atomic with respect to Record, so a few samples may be lost */
+            void Reset()
+            {
+                for (int i = 0; i < BUCKETS; i++)
+                    _buckets[i].store(0, std::memory_order_relaxed);
+                _count.store(0, std::memory_order_relaxed);
+                _sum.store(0, std::memory_order_relaxed);
+                _max.store(0, std::memory_order_relaxed);
+            }
+
+            uint64_t GetCount() { return _count.load(std::memory_order_relaxed); }
+            uint64_t GetMax() { return _max.load(std::memory_order_relaxed); }
+            uint64_t GetSum() { return _sum.load(std::memory_order_relaxed); }
+            uint64_t GetMean()
+            {
+                uint64_t count = GetCount();
+                return count ? _sum.load(std::memory_order_relaxed) / count : 0;
+            }
+
+            /** @param fraction 0.5 for the median, 0.99 for the 99th percentile, etc.
+             *  @return The upper bound of the bucket holding that value, or the maximum if that is less
+             */
+            uint64_t GetPercentile(double fraction)
+            {
+                uint64_t total = 0;
+                for (int i = 0; i < BUCKETS; i++)
+                    total += _buckets[i].load(std::memory_order_relaxed);
+                if (total == 0)
+                    return 0;
+
+                uint64_t target = fraction * total;
+                if (target >= total)
+                    target = total - 1;
+                uint64_t seen = 0;
+                for (int i = 0; i < BUCKETS; i++)
+                {
+                    seen += _buckets[i].load(std::memory_order_relaxed);
+                    if (seen > target)
+                    {
+                        uint64_t upper = _lowest(i + 1) - 1;
+                        uint64_t max = GetMax();
+                        return upper < max ? upper : max;
+                    }
+                }
+                return GetMax();
+            }
+
+        private:
+            static int _bucket(uint64_t ns)
+            {
+                if (ns < SUB_BUCKETS)
+                    return ns;
+                int msb = 63 - __builtin_clzll(ns);
+                int bucket = (msb - SUB_BITS + 1) * SUB_BUCKETS + ((ns >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1));
+                return bucket < BUCKETS ? bucket : BUCKETS - 1;
+            }
+
+            // smallest value recorded in a bucket
+            static uint64_t _lowest(int bucket)
+            {
+                if (bucket < SUB_BUCKETS)
+                    return bucket;
+                int msb = bucket / SUB_BUCKETS + SUB_BITS - 1;
+                return (uint64_t)(SUB_BUCKETS + bucket % SUB_BUCKETS) << (msb - SUB_BITS);
+            }
+
+            std::array<std::atomic<uint32_t>, BUCKETS> _buckets;
+            std::atomic<uint64_t> _count;
+            std::atomic<uint64_t> _sum;
+            std::atomic<uint64_t> _max;
+    };
+
+    /** Records the time from its construction to the end of its scope in a histogram */
+    class StageTimer
+    {
+        public:
+            explicit StageTimer(LatencyHistogram *histogram) :
+                _histogram(histogram),
+                _start(std::chrono::steady_clock::now())
+            {
+            }
+
+            ~StageTimer()
+            {
+                _histogram->Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count());
+            }
+
+        private:
+            LatencyHistogram* _histogram;
+            std::chrono::steady_clock::time_point _start;
+    };
+}
+
+#endif // _LATENCYHISTOGRAM_H_
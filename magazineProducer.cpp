@@ -0,0 +1,130 @@
+/** MagazineProducer
+ */
+#include "magazineProducer.h"
+
+using namespace vbit;
+
+#define PRODUCER_QUEUE 32 // most packets built ahead per magazine. About two fields of a full service.
+#define PRODUCER_FIELDS 2 // fields of packets built ahead, so that clocks and substitutions are no staler than this
+#define PRODUCER_MIN 2 // packets built ahead of a magazine which got no lines last field
+
+MagazineProducer::MagazineProducer(PacketMag *mag, Debug *debug) :
+    _mag(mag),
+    _debug(debug),
+    _queue(PRODUCER_QUEUE),
+    _events(0),
+    _rate(0),
+    _hasNext(false),
+    _fieldStarted(false),
+    _taken(0),
+    _priorityCount(1),
+    _holdNext(false)
+{
+}
+
+void MagazineProducer::Start()
+{
+    std::thread worker(&MagazineProducer::_run, this);
+    worker.detach();
+}
+
+void MagazineProducer::SetEvent(Event event)
+{
+    PacketSource::SetEvent(event); // field events are acted on here
+    if (event != EVENT_FIELD)
+        _events.fetch_or(1u << event); // the worker stands in for field events so it can build ahead of them
+}
+
+bool MagazineProducer::IsReady(bool force)
+{
+    if (GetEvent(EVENT_FIELD))
+    {
+        ClearEvent(EVENT_FIELD);
+        _fieldStarted = true;
+        _rate = _taken; // packets this magazine is getting per field
+        _taken = 0;
+    }
+
+    if (!_hasNext)
+    {
+        _hasNext = _queue.Pop(&_next);
+        if (!_hasNext)
+            return false; // nothing built yet
+    }
+
+    if (_next.holdForField && !_fieldStarted)
+        return false; // page erasure interval
+
+    // the same priority count as PacketMag::IsReady
+    _priorityCount--;
+    if (_priorityCount == 0 || force || _next.urgent)
+    {
+        _priorityCount = _mag->GetPriority();
+        return true;
+    }
+    return false;
+}
+
+Packet* MagazineProducer::GetPacket(Packet* p)
+{
+    // We should only call GetPacket if IsReady has returned true
+    if (!_hasNext)
+        return nullptr;
+
+    p->SetTxPacket(_next.packet);
+    _hasNext = false;
+    _fieldStarted = false;
+    _taken++;
+    return p;
+}
+
+void MagazineProducer::_run()
+{
+    Packet* pkt = new Packet(8,25); // This just allocates storage.
+    QueuedPacket queued;
+
+    while (true)
+    {
+        bool built = false;
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+
+            uint32_t events = _events.exchange(0);
+            for (int ev = 0; ev < EVENT_NUMBER_ITEMS; ev++)
+            {
+                if (events & (1u << ev))
+                    _mag->SetEvent((Event)ev);
+            }
+
+            // a magazine given few lines would take many fields to send a full queue, so only build a few fields ahead
+            std::size_t limit = std::min(_queue.Capacity(), std::max((std::size_t)PRODUCER_MIN, (std::size_t)_rate * PRODUCER_FIELDS));
+            if (_queue.Size() < limit)
+            {
+                if (_mag->IsWaitingForField())
+                {
+                    // carry on building, and leave the service thread to wait for the field
+                    _mag->SetEvent(EVENT_FIELD);
+                    _holdNext = true;
+                }
+
+                queued.urgent = _mag->GetUpdatedPages()->waiting();
+
+                // priority is applied when the service thread takes the packet, so force the magazine here
+                if (_mag->IsReady(true) && _mag->GetPacket(pkt) != nullptr)
+                {
+                    {
+                        StageTimer timer(_debug->GetHistogram(Debug::stageTX));
+                        queued.packet = *pkt->tx();
+                    }
+                    queued.holdForField = _holdNext;
+                    _queue.Push(queued);
+                    _holdNext = false;
+                    built = true;
+                }
+            }
+        }
+
+        if (!built)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1)); // queue is full or the magazine is waiting
+    }
+}
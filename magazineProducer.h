@@ -0,0 +1,70 @@
+#ifndef _MAGAZINEPRODUCER_H_
+#define _MAGAZINEPRODUCER_H_
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <array>
+
+#include "packetsource.h"
+#include "packetmag.h"
+#include "spscQueue.h"
+
+namespace vbit
+{
+    /** MagazineProducer runs a PacketMag on a thread of its own, building its packets ahead into a queue.
+     *  It stands in for the magazine as a packet source on the service thread, so the scheduler and the
+     *  magazine priorities work as before, but page selection, encoding and checksums for the eight
+     *  magazines run in parallel.
+     *  Packets are built across the page erasure interval. The packet after a header is held in the
+     *  queue until a new field has started, so the transmitted sequence is timed as if built inline.
+     *  Headers and substitutions are filled in as packets are built, so the queue is kept to a couple
+     *  of fields of the lines the magazine is actually getting.
+     */
+    class MagazineProducer : public PacketSource
+    {
+        public:
+            MagazineProducer(PacketMag *mag, Debug *debug);
+
+            /** Start the worker thread */
+            void Start();
+
+            /** Service thread only */
+            Packet* GetPacket(Packet* p) override;
+            bool IsReady(bool force=false) override;
+            void SetEvent(Event event) override;
+
+            /** Stop building packets so that the magazine and its pages can be changed from the service thread */
+            void Pause() { _mtx.lock(); };
+            void Resume() { _mtx.unlock(); };
+
+        private:
+            struct QueuedPacket
+            {
+                std::array<uint8_t, PACKETSIZE> packet;
+                bool holdForField; // must not go until a field has started since the previous packet
+                bool urgent; // updated pages were waiting, so skip the priority count
+            };
+
+            void _run();
+
+            PacketMag* _mag;
+            Debug* _debug;
+            SpscQueue<QueuedPacket> _queue;
+            std::mutex _mtx; // held by the worker while it runs the magazine
+            std::atomic<uint32_t> _events; // events to be passed on to the magazine by the worker
+            std::atomic<uint32_t> _rate; // packets taken by the service thread in the last field
+
+            // service thread
+            QueuedPacket _next;
+            bool _hasNext; // _next has been taken from the queue but not sent
+            bool _fieldStarted; // a field has started since the last packet was sent
+            uint32_t _taken; // packets taken so far this field
+            uint8_t _priorityCount;
+
+            // worker thread
+            bool _holdNext;
+    };
+}
+
+#endif
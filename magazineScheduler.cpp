@@ -0,0 +1,146 @@
+/** MagazineScheduler
+ */
+#include "magazineScheduler.h"
+
+using namespace vbit;
+
+#define DRR_QUANTUM 24.0 // credit given to the heaviest magazine per visit. About one page of rows.
+#define DRR_MINWEIGHT (DRR_QUANTUM / 100) // bounds for weights adjusted to meet a cycle time target
+#define DRR_MAXWEIGHT (DRR_QUANTUM * 4)
+
+PriorityScheduler::PriorityScheduler(std::list<PacketSource*> *sources) :
+    _sources(sources)
+{
+    _iterator = _sources->begin();
+}
+
+PacketSource* PriorityScheduler::NextSource()
+{
+    PacketSource* p=nullptr;
+    uint8_t sourceCount=0;
+    uint8_t listSize=_sources->size();
+    bool force=false;
+    do
+    {
+        // Loop back to the first source
+        if (_iterator==_sources->end())
+        {
+            _iterator=_sources->begin();
+        }
+
+        // If we have tried all sources with and without force, then break out with a filler to prevent a deadlock
+        if (sourceCount>listSize*2)
+        {
+            p=nullptr;
+            // If we get a lot of this maybe there is a problem?
+            break;
+        }
+
+        // If we have gone around once and got nothing, then force sources to go if possible.
+        if (sourceCount>listSize)
+        {
+            force=true;
+        }
+
+        // Get the packet source
+        p=(*_iterator);
+        ++_iterator;
+
+        sourceCount++; // Count how many sources we tried.
+    }
+    while (!p->IsReady(force));
+    
+    return p;
+}
+
+WeightedScheduler::WeightedScheduler(PacketMag **magList, PacketSource **sources, Configure *configure, Debug *debug) :
+    _magList(magList),
+    _sources(sources),
+    _debug(debug),
+    _current(1) // start at magazine 1
+{
+    double maxWeight = 0;
+    for (int i=0; i<8; i++)
+        if (configure->GetMagazineWeight(i) > maxWeight)
+            maxWeight = configure->GetMagazineWeight(i);
+    
+    for (int i=0; i<8; i++)
+    {
+        _magList[i]->SetPriority(1); // credit replaces priority counting
+        _weight[i] = DRR_QUANTUM * configure->GetMagazineWeight(i) / maxWeight;
+        _deficit[i] = 0;
+        _target[i] = configure->GetMagazineCycleTarget(i) * 50;
+        _lastCycle[i] = 0;
+    }
+    
+    _deficit[_current] = _weight[_current];
+}
+
+void WeightedScheduler::_advance()
+{
+    _current = (_current + 1) % 8;
+    _deficit[_current] += _weight[_current];
+}
+
+PacketSource* WeightedScheduler::NextSource()
+{
+    // visit each magazine once looking for one with credit that has something to send
+    for (int count=0; count<8; count++)
+    {
+        if (_deficit[_current] >= 1)
+        {
+            if (_sources[_current]->IsReady())
+            {
+                _deficit[_current]--;
+                return _sources[_current];
+            }
+            _deficit[_current] = 0; // a magazine which isn't ready loses its credit, so it can't bank a burst while it waits
+        }
+        _advance();
+    }
+    
+    // nobody ready has credit left, so let the ready magazine with most credit borrow the line
+    int best = -1;
+    for (int i=0; i<8; i++)
+    {
+        if (_sources[i]->IsReady(true) && (best < 0 || _deficit[i] > _deficit[best]))
+            best = i;
+    }
+    
+    if (best < 0)
+        return nullptr;
+    
+    _deficit[best]--;
+    return _sources[best];
+}
+
+void WeightedScheduler::NewSecond()
+{
+    for (int i=0; i<8; i++)
+    {
+        if (_target[i] == 0)
+            continue;
+        
+        int cycle = _magList[i]->GetCycleDuration();
+        if (cycle <= 0 || cycle == _lastCycle[i])
+            continue; // no new measurement since last adjustment
+        _lastCycle[i] = cycle;
+        
+        // scale share by the ratio of measured to target cycle time, damped to avoid oscillation
+        double ratio = (double)cycle / _target[i];
+        if (ratio > 2)
+            ratio = 2;
+        else if (ratio < 0.5)
+            ratio = 0.5;
+        _weight[i] *= (1 + ratio) / 2;
+        
+        if (_weight[i] > DRR_MAXWEIGHT)
+            _weight[i] = DRR_MAXWEIGHT;
+        else if (_weight[i] < DRR_MINWEIGHT)
+            _weight[i] = DRR_MINWEIGHT;
+        
+        std::stringstream ss;
+        ss << "[WeightedScheduler::NewSecond] magazine " << (i?i:8) << " cycle " << cycle << " fields, target " << _target[i] << ", weight " << _weight[i];
+        _debug->Log(Debug::LogLevels::logDEBUG,ss.str());
+    }
+}
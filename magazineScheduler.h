@@ -0,0 +1,80 @@
+#ifndef _MAGAZINESCHEDULER_H_
+#define _MAGAZINESCHEDULER_H_
+
+#include <list>
+#include <array>
+
+#include "configure.h"
+#include "debug.h"
+#include "packetsource.h"
+#include "packetmag.h"
+
+namespace vbit
+{
+    /** A MagazineScheduler decides which magazine gets the next VBI line.
+     *  Service asks it for a source once per magazine line and calls NewSecond() as the master clock ticks.
+     */
+    class MagazineScheduler
+    {
+        public:
+            virtual ~MagazineScheduler(){};
+            
+            /** Pick the magazine to transmit from
+             *  @return a magazine packet source which is ready, or nullptr if a filler should be sent
+             */
+            virtual PacketSource* NextSource()=0;
+            
+            /** Called once per second so that policies can respond to measured cycle times */
+            virtual void NewSecond(){};
+    };
+    
+    /** The original vbit2 policy.
+     *  Magazines are polled round robin and hold themselves back according to magazine_priority.
+     *  If nothing is ready after one pass the magazines are forced, and after two passes a filler goes out.
+     */
+    class PriorityScheduler : public MagazineScheduler
+    {
+        public:
+            PriorityScheduler(std::list<PacketSource*> *sources);
+            
+            PacketSource* NextSource() override;
+            
+        private:
+            std::list<PacketSource*> *_sources;
+            std::list<PacketSource*>::const_iterator _iterator;
+    };
+    
+    /** Deficit round robin over the magazines.
+     *  Each magazine earns credit in proportion to its weight every time it is visited and spends one
+     *  credit per packet, so over time the VBI lines are shared in the ratio of the weights.
+     *  Magazines with a cycle time target have their weight adjusted as their measured cycle time changes.
+     *  Unused lines are given to the ready magazine with the most credit so no line is wasted on filler.
+     */
+    class WeightedScheduler : public MagazineScheduler
+    {
+        public:
+            /**
+             * @param magList The eight magazines, for their measured cycle times
+             * @param sources The packet sources transmitting each magazine
+             */
+            WeightedScheduler(PacketMag **magList, PacketSource **sources, Configure *configure, Debug *debug);
+            
+            PacketSource* NextSource() override;
+            void NewSecond() override;
+            
+        private:
+            PacketMag **_magList;
+            PacketSource **_sources;
+            Debug* _debug;
+            
+            std::array<double, 8> _weight; // current share of each magazine
+            std::array<double, 8> _deficit; // packets each magazine may send before yielding
+            std::array<int, 8> _target; // target cycle time in fields, 0 for none
+            std::array<int, 8> _lastCycle; // last measured cycle duration acted upon
+            int _current; // magazine being served
+            
+            void _advance();
+    };
+}
+
+#endif
@@ -0,0 +1,22 @@
+#include "masterClock.h"
+
+using namespace vbit;
+
+MasterClock MasterClock::_instance; // created before main() so there is no first use check
+
+#if ATOMIC_LLONG_LOCK_FREE == 2
+MasterClock::MasterClock() :
+    _steps(0),
+    _fields(((int64_t)time(NULL) - 1) * 50) // initialise master clock to system time - 1
+{
+}
+#else
+MasterClock::MasterClock() :
+    _steps(0),
+    _sequence(0),
+    _high(0),
+    _low(0)
+{
+    _store(((int64_t)time(NULL) - 1) * 50); // initialise master clock to system time - 1
+}
+#endif
@@ -3,9 +3,16 @@
 
 #include <cstdint>
 #include <ctime>
+#include <atomic>
 
 namespace vbit
 {
+    /** The master clock is a count of fields since the epoch, stepped by the primary service.
+     *  It is a single atomic value so any thread can read a consistent time without locking.
+     *  Where 64 bit atomics aren't lock free (e.g. ARMv6 Raspbian, where libatomic uses locks) the count
+     *  is kept in two 32 bit halves under a sequence number instead. There is only one writer, so it
+     *  never waits, and a reader only repeats its read if it overlaps a write.
+     */
     class MasterClock {
         public:
             struct timeStruct {
@@ -13,20 +20,70 @@ namespace vbit
                 uint8_t fields;
             };
             
-            static MasterClock *Instance(){
-                if (!instance)
-                    instance = new MasterClock;
-                return instance;
+            static MasterClock *Instance(){ return &_instance; }
+            
+            void SetMasterClock(timeStruct t){ _store((int64_t)t.seconds * 50 + t.fields); }
+            /** Set the clock where it jumps rather than counting on, so intervals measured across the jump can be discarded */
+            void StepMasterClock(timeStruct t){ SetMasterClock(t); _steps.fetch_add(1, std::memory_order_release); }
+            timeStruct GetMasterClock(){
+                int64_t fields = GetFields();
+                timeStruct t = {(time_t)(fields / 50), (uint8_t)(fields % 50)};
+                return t;
             }
             
-            void SetMasterClock(timeStruct t){ _masterClock = t; }
-            timeStruct GetMasterClock(){ return _masterClock; }
+            /** @return Fields since the epoch */
+            int64_t GetFields();
+            time_t GetSeconds(){ return GetFields() / 50; }
+            /** @return Times the clock has been stepped */
+            uint32_t GetSteps(){ return _steps.load(std::memory_order_acquire); }
             
         private:
-            MasterClock(){ _masterClock = {time(NULL)-1, 0}; }; // initialise master clock to system time - 1
-            static MasterClock *instance;
-            timeStruct _masterClock;
+            MasterClock();
+            MasterClock(const MasterClock&) = delete;
+            MasterClock& operator=(const MasterClock&) = delete;
+            
+            void _store(int64_t fields);
+            
+            static MasterClock _instance;
+            std::atomic<uint32_t> _steps;
+#if ATOMIC_LLONG_LOCK_FREE == 2
+            std::atomic<int64_t> _fields;
+#else
+            static_assert(ATOMIC_INT_LOCK_FREE == 2, "the master clock needs lock free 32 bit atomics");
+            std::atomic<uint32_t> _sequence; // odd while the halves are being written
+            std::atomic<uint32_t> _high;
+            std::atomic<uint32_t> _low;
+#endif
     };
+    
+#if ATOMIC_LLONG_LOCK_FREE == 2
+    inline void MasterClock::_store(int64_t fields){ _fields.store(fields, std::memory_order_release); }
+    inline int64_t MasterClock::GetFields(){ return _fields.load(std::memory_order_acquire); }
+#else
+    inline void MasterClock::_store(int64_t fields)
+    {
+        uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+        _sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _high.store((uint64_t)fields >> 32, std::memory_order_relaxed);
+        _low.store((uint32_t)fields, std::memory_order_relaxed);
+        _sequence.store(sequence + 2, std::memory_order_release);
+    }
+    
+    inline int64_t MasterClock::GetFields()
+    {
+        uint32_t before, after, high, low;
+        do
+        {
+            before = _sequence.load(std::memory_order_acquire);
+            high = _high.load(std::memory_order_relaxed);
+            low = _low.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = _sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return (int64_t)(((uint64_t)high << 32) | low);
+    }
+#endif
 }
 
 #endif // _MASTERCLOCK_H_
@@ -0,0 +1,318 @@
+/* Provide an HTTP endpoint serving the service's statistics to monitoring systems */
+
+#include "metricsServer.h"
+
+using namespace vbit;
+
+MetricsServer::MetricsServer(Configure *configure, Debug *debug, PacketServer *packetServer, InterfaceServer *interfaceServer) :
+    _debug(debug),
+    _packetServer(packetServer),
+    _interfaceServer(interfaceServer),
+    _portNumber(configure->GetMetricsServerPort())
+{
+    _serverSock = -1;
+}
+
+MetricsServer::~MetricsServer()
+{
+}
+
+void MetricsServer::DieWithError(std::string errorMessage)
+{
+    if (_serverSock >= 0)
+    {
+        #ifdef WIN32
+            closesocket(_serverSock);
+        #else
+            close(_serverSock);
+        #endif
+    }
+    
+    perror(errorMessage.c_str());
+    exit(1);
+}
+
+void MetricsServer::_header(std::ostringstream &out, std::string name, std::string type, std::string help)
+{
+    out << "# HELP vbit2_" << name << " " << help << "\n";
+    out << "# TYPE vbit2_" << name << " " << type << "\n";
+}
+
+std::string MetricsServer::_pageName(int page)
+{
+    // magazine 1-8 then the page number in hex, as it is written in page files
+    std::ostringstream name;
+    name << (((page >> 8) & 7) ? (page >> 8) & 7 : 8) << std::uppercase << std::hex << std::setw(2) << std::setfill('0') << (page & 0xFF);
+    return name.str();
+}
+
+std::string MetricsServer::GetMetrics()
+{
+    std::ostringstream out;
+    
+    _header(out, "packets_total", "counter", "Packets transmitted by source.");
+    for (int mag=1; mag<=8; mag++)
+        out << "vbit2_packets_total{source=\"magazine\",magazine=\"" << mag << "\"} " << _debug->GetPackets(Debug::srcMAGAZINE + (mag & 7)) << "\n";
+    out << "vbit2_packets_total{source=\"bsdp\"} " << _debug->GetPackets(Debug::srcBSDP) << "\n";
+    out << "vbit2_packets_total{source=\"debug\"} " << _debug->GetPackets(Debug::srcDEBUG) << "\n";
+    out << "vbit2_packets_total{source=\"datacast\"} " << _debug->GetPackets(Debug::srcDATACAST) << "\n";
+    out << "vbit2_packets_total{source=\"filler\"} " << _debug->GetPackets(Debug::srcFILLER) << "\n";
+    
+    const int windows[] = {1, 10, 60}; // seconds
+    std::array<Debug::LineUsage, 3> usage;
+    for (int w=0; w<3; w++)
+        usage[w] = _debug->GetLineUsage(windows[w]);
+    
+    _header(out, "lines_per_field", "gauge", "Mean VBI lines per field used by each source, or as filler.");
+    for (int w=0; w<3; w++)
+    {
+        uint32_t filler = 0;
+        for (int i=Debug::lineFILLER; i<Debug::lineCOUNT; i++)
+            filler += usage[w].lines[i];
+        for (int i=0; i<Debug::lineFILLER; i++)
+            out << "vbit2_lines_per_field{use=\"" << Debug::GetLineUseName((Debug::LineUses)i) << "\",window=\"" << windows[w] << "s\"} " << (usage[w].fields ? (double)usage[w].lines[i] / usage[w].fields : 0) << "\n";
+        out << "vbit2_lines_per_field{use=\"filler\",window=\"" << windows[w] << "s\"} " << (usage[w].fields ? (double)filler / usage[w].fields : 0) << "\n";
+    }
+    
+    _header(out, "filler_lines_per_field", "gauge", "Mean filler lines per field by the reason nothing else was sent.");
+    for (int w=0; w<3; w++)
+    {
+        for (int i=Debug::lineFILLER; i<Debug::lineCOUNT; i++)
+            out << "vbit2_filler_lines_per_field{reason=\"" << Debug::GetLineUseName((Debug::LineUses)i) << "\",window=\"" << windows[w] << "s\"} " << (usage[w].fields ? (double)usage[w].lines[i] / usage[w].fields : 0) << "\n";
+    }
+    
+    _header(out, "filler_lines_max_per_field", "gauge", "Most filler lines in any one field.");
+    for (int w=0; w<3; w++)
+        out << "vbit2_filler_lines_max_per_field{window=\"" << windows[w] << "s\"} " << usage[w].maxFiller << "\n";
+    
+    uint32_t filler = 0;
+    for (int i=Debug::lineFILLER; i<Debug::lineCOUNT; i++)
+        filler += usage[0].lines[i];
+    _header(out, "filler_per_second", "gauge", "Filler packets sent in the last second.");
+    out << "vbit2_filler_per_second " << filler << "\n";
+    
+    _header(out, "line_utilisation", "gauge", "Fraction of VBI lines carrying data rather than filler.");
+    for (int w=0; w<3; w++)
+    {
+        uint32_t lines = 0;
+        uint32_t filler = 0;
+        for (int i=0; i<Debug::lineCOUNT; i++)
+        {
+            lines += usage[w].lines[i];
+            if (i >= Debug::lineFILLER)
+                filler += usage[w].lines[i];
+        }
+        out << "vbit2_line_utilisation{window=\"" << windows[w] << "s\"} " << (lines ? (double)(lines - filler) / lines : 0) << "\n";
+    }
+    
+    std::array<int,8> durations = _debug->GetMagCycleDurations();
+    _header(out, "magazine_cycle_seconds", "gauge", "Duration of the last complete cycle of each magazine.");
+    for (int mag=1; mag<=8; mag++)
+    {
+        if (durations[mag & 7] >= 0) // -1 until a cycle has been timed
+            out << "vbit2_magazine_cycle_seconds{magazine=\"" << mag << "\"} " << durations[mag & 7] / 50.0 << "\n";
+    }
+    
+    std::array<int,8> sizes = _debug->GetMagSizes();
+    _header(out, "magazine_pages", "gauge", "Pages in each magazine.");
+    for (int mag=1; mag<=8; mag++)
+        out << "vbit2_magazine_pages{magazine=\"" << mag << "\"} " << sizes[mag & 7] << "\n";
+    
+    _header(out, "updated_pages_queued", "gauge", "Updated pages waiting to be sent ahead of the cycle in each magazine.");
+    for (int mag=1; mag<=8; mag++)
+        out << "vbit2_updated_pages_queued{magazine=\"" << mag << "\"} " << _debug->GetUpdatedPagesQueued(mag & 7) << "\n";
+    
+    _header(out, "lock_failures_total", "counter", "Times a page or packet 29 was found locked when it was due in each magazine.");
+    for (int mag=1; mag<=8; mag++)
+        out << "vbit2_lock_failures_total{magazine=\"" << mag << "\"} " << _debug->GetLockFailures(mag & 7) << "\n";
+    
+    _header(out, "skipped_transmissions_total", "counter", "Page transmissions lost in each magazine because the page was locked.");
+    for (int mag=1; mag<=8; mag++)
+        out << "vbit2_skipped_transmissions_total{magazine=\"" << mag << "\"} " << _debug->GetSkippedTransmissions(mag & 7) << "\n";
+    
+    _header(out, "longest_untransmitted_seconds", "gauge", "Longest time any page in each magazine has gone between transmissions.");
+    for (int mag=1; mag<=8; mag++)
+        out << "vbit2_longest_untransmitted_seconds{magazine=\"" << mag << "\"} " << _debug->GetLongestGap(mag & 7) / 50.0 << "\n";
+    
+    // only pages which have been locked, to keep the number of series down
+    std::map<int, Debug::PageLockStats> pageLocks = _debug->GetPageLockStats();
+    _header(out, "page_lock_failures_total", "counter", "Times each page was found locked when it was due.");
+    for (std::map<int, Debug::PageLockStats>::iterator it = pageLocks.begin(); it != pageLocks.end(); ++it)
+    {
+        if (it->second.lockFailures)
+            out << "vbit2_page_lock_failures_total{page=\"" << _pageName(it->first) << "\"} " << it->second.lockFailures << "\n";
+    }
+    _header(out, "page_skipped_transmissions_total", "counter", "Transmissions of each page lost because it was locked.");
+    for (std::map<int, Debug::PageLockStats>::iterator it = pageLocks.begin(); it != pageLocks.end(); ++it)
+    {
+        if (it->second.lockFailures)
+            out << "vbit2_page_skipped_transmissions_total{page=\"" << _pageName(it->first) << "\"} " << it->second.skipped << "\n";
+    }
+    _header(out, "page_longest_untransmitted_seconds", "gauge", "Longest time each page which has been locked went between transmissions.");
+    for (std::map<int, Debug::PageLockStats>::iterator it = pageLocks.begin(); it != pageLocks.end(); ++it)
+    {
+        if (it->second.lockFailures)
+            out << "vbit2_page_longest_untransmitted_seconds{page=\"" << _pageName(it->first) << "\"} " << it->second.longestGap / 50.0 << "\n";
+    }
+    
+    PacketDatacast** channels = _interfaceServer->GetDatachannels();
+    _header(out, "datacast_buffer_packets", "gauge", "Packets waiting in each datacast channel's buffer.");
+    for (int dc=1; dc<16; dc++)
+        out << "vbit2_datacast_buffer_packets{channel=\"" << dc << "\"} " << channels[dc]->GetBufferOccupancy() << "\n";
+    
+    _header(out, "page_loads_total", "counter", "Page files read by the file monitor, by outcome.");
+    out << "vbit2_page_loads_total{kind=\"added\"} " << _debug->GetPageLoads(Debug::loadADDED) << "\n";
+    out << "vbit2_page_loads_total{kind=\"reloaded\"} " << _debug->GetPageLoads(Debug::loadRELOADED) << "\n";
+    out << "vbit2_page_loads_total{kind=\"unchanged\"} " << _debug->GetPageLoads(Debug::loadUNCHANGED) << "\n";
+    out << "vbit2_page_loads_total{kind=\"failed\"} " << _debug->GetPageLoads(Debug::loadFAILED) << "\n";
+    
+    _header(out, "stage_duration_seconds", "summary", "Time taken by each stage of the service.");
+    for (int i=0; i<Debug::stageCOUNT; i++)
+    {
+        std::string stage = Debug::GetStageName((Debug::Stages)i);
+        LatencyHistogram *h = _debug->GetHistogram((Debug::Stages)i);
+        out << "vbit2_stage_duration_seconds{stage=\"" << stage << "\",quantile=\"0.5\"} " << h->GetPercentile(0.5) / 1e9 << "\n";
+        out << "vbit2_stage_duration_seconds{stage=\"" << stage << "\",quantile=\"0.99\"} " << h->GetPercentile(0.99) / 1e9 << "\n";
+        out << "vbit2_stage_duration_seconds{stage=\"" << stage << "\",quantile=\"0.999\"} " << h->GetPercentile(0.999) / 1e9 << "\n";
+        out << "vbit2_stage_duration_seconds_sum{stage=\"" << stage << "\"} " << h->GetSum() / 1e9 << "\n";
+        out << "vbit2_stage_duration_seconds_count{stage=\"" << stage << "\"} " << h->GetCount() << "\n";
+    }
+    
+    _header(out, "output_queue_lines", "gauge", "Lines generated but not yet written.");
+    out << "vbit2_output_queue_lines " << _debug->GetOutputQueue() << "\n";
+    _header(out, "output_underruns_total", "counter", "Times the output waited for packets.");
+    out << "vbit2_output_underruns_total " << _debug->GetOutputUnderruns() << "\n";
+    _header(out, "pacing_jitter_seconds", "gauge", "Lateness waking for output over the last second.");
+    out << "vbit2_pacing_jitter_seconds{stat=\"mean\"} " << _debug->GetPacingJitterMean() / 1e6 << "\n";
+    out << "vbit2_pacing_jitter_seconds{stat=\"max\"} " << _debug->GetPacingJitterMax() / 1e6 << "\n";
+    
+    _header(out, "clock_resyncs_total", "counter", "Times the master clock was stepped.");
+    out << "vbit2_clock_resyncs_total " << _debug->GetClockResyncs() << "\n";
+    _header(out, "clock_slews_total", "counter", "Times the master clock started slewing.");
+    out << "vbit2_clock_slews_total " << _debug->GetClockSlews() << "\n";
+    _header(out, "clock_slew_ppm", "gauge", "Current master clock slew.");
+    out << "vbit2_clock_slew_ppm " << _debug->GetClockSlewRate() << "\n";
+    
+    _header(out, "clients", "gauge", "Clients connected to each server.");
+    out << "vbit2_clients{server=\"packet\"} " << _packetServer->GetClientCount() << "\n";
+    out << "vbit2_clients{server=\"interface\"} " << _interfaceServer->GetClientCount() << "\n";
+    
+    return out.str();
+}
+
+void MetricsServer::_handleClient(int sock)
+{
+    char readBuffer[BUFFLEN];
+    std::string request;
+    
+    // read up to the end of the request headers, which is all a GET has
+    while (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos && request.size() < BUFFLEN)
+    {
+        int n = recv(sock, readBuffer, BUFFLEN, 0);
+        if (n <= 0)
+            return; // closed or timed out
+        request.append(readBuffer, n);
+    }
+    
+    std::string status;
+    std::string body;
+    std::string line = request.substr(0, request.find_first_of("\r\n"));
+    if (line.compare(0, 12, "GET /metrics") == 0 || line.compare(0, 6, "GET / ") == 0)
+    {
+        status = "200 OK";
+        body = GetMetrics();
+    }
+    else
+    {
+        status = "404 Not Found";
+        body = "Not found\n";
+    }
+    
+    std::string response = "HTTP/1.0 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    
+    int flags = 0;
+    #ifdef MSG_NOSIGNAL
+        flags = MSG_NOSIGNAL; // a scraper hanging up must not raise SIGPIPE
+    #endif
+    
+    std::size_t sent = 0;
+    while (sent < response.size())
+    {
+        int n = send(sock, response.data() + sent, response.size() - sent, flags);
+        if (n <= 0)
+        {
+            _debug->Log(Debug::LogLevels::logWARN,"[MetricsServer::_handleClient] send() failed");
+            return;
+        }
+        sent += n;
+    }
+}
+
+void MetricsServer::run()
+{
+    _debug->Log(Debug::LogLevels::logINFO,"[MetricsServer::run] Metrics server thread started on port " + std::to_string(_portNumber));
+    
+    int sock;
+    struct sockaddr_in address;
+
+#ifdef WIN32
+    int addrlen;
+    WSADATA wsaData;
+    int iResult;
+    
+    // Initialize Winsock
+    iResult = WSAStartup(MAKEWORD(2,2), &wsaData);
+    if (iResult != 0)
+    {
+        DieWithError("[MetricsServer::run] WSAStartup failed");
+    }
+    DWORD timeout = 1000;
+#else
+    unsigned int addrlen;
+    struct timeval timeout = {1, 0};
+#endif
+
+    /* Create socket */
+    if ((_serverSock = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0)
+        DieWithError("[MetricsServer::run] socket() failed\n");
+    
+    int reuse = true;
+    
+    if(setsockopt(_serverSock, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse)) < 0)
+        DieWithError("[MetricsServer::run] setsockopt() SO_REUSEADDR failed");
+    
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(_portNumber);
+    
+    /* bind socked */
+    if (bind(_serverSock, (struct sockaddr *) &address, sizeof(address)) < 0)
+        DieWithError("[MetricsServer::run] bind() failed");
+    
+    /* Listen for incoming connections */
+    if (listen(_serverSock, MAXPENDING) < 0)
+        DieWithError("[MetricsServer::run] listen() failed");
+    
+    while(true)
+    {
+        addrlen = sizeof(address);
+        if ((sock = accept(_serverSock, (struct sockaddr *)&address, &addrlen)) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            DieWithError("[MetricsServer::run] accept() failed");
+        }
+        
+        // don't let a slow client hold up the next scrape
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout));
+        
+        _handleClient(sock);
+        
+        #ifdef WIN32
+            closesocket(sock);
+        #else
+            close(sock);
+        #endif
+    }
+}
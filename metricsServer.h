@@ -0,0 +1,59 @@
+#ifndef _METRICSSERVER_H_
+#define _METRICSSERVER_H_
+
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <map>
+
+#include "configure.h"
+#include "debug.h"
+#include "packetServer.h"
+#include "interfaceServer.h"
+
+#ifdef WIN32
+#include <winsock2.h>
+#else
+#include <sys/socket.h> /* for socket(), bind(), and connect() */
+#include <sys/time.h>   /* for timeval */
+#include <arpa/inet.h>  /* for sockaddr_in and inet_ntoa() */
+#include <unistd.h>     /* for close() */
+#endif
+
+namespace vbit
+{
+    /** A minimal HTTP server answering GET /metrics with a service's counters and gauges in the
+     *  Prometheus text exposition format, so that monitoring systems can scrape them.
+     *  Each request is handled in turn on the server's thread and the connection closed.
+     */
+    class MetricsServer
+    {
+        public:
+            MetricsServer(Configure *configure, Debug *debug, PacketServer *packetServer, InterfaceServer *interfaceServer);
+            ~MetricsServer();
+            
+            void run();
+            
+            /** @return The current metrics as a text exposition */
+            std::string GetMetrics();
+        
+        private:
+            static const uint16_t MAXPENDING=5;
+            static const uint16_t BUFFLEN=1024;
+            
+            Debug* _debug;
+            PacketServer* _packetServer;
+            InterfaceServer* _interfaceServer;
+            
+            int _portNumber;
+            int _serverSock;
+            
+            void _handleClient(int sock);
+            void _header(std::ostringstream &out, std::string name, std::string type, std::string help);
+            std::string _pageName(int page);
+            
+            void DieWithError(std::string errorMessage); // handle fatal socket errors
+    };
+}
+
+#endif
@@ -10,6 +10,7 @@ NormalPages::NormalPages(int mag, PageList *pageList, Debug *debug) :
 {
     _iter=_NormalPagesList.begin();
     _page=nullptr;
+    _position=0;
 }
 
 NormalPages::~NormalPages()
@@ -37,6 +38,25 @@ void NormalPages::addPage(std::shared_ptr<TTXPageStream> p)
 
 std::shared_ptr<TTXPageStream> NormalPages::NextPage()
 {
+    // extra transmissions of repeated pages go out once the cycle has moved on far enough
+    while (!_repeats.empty() && _repeats.begin()->first <= _position)
+    {
+        std::shared_ptr<TTXPageStream> r = _repeats.begin()->second;
+        _repeats.erase(_repeats.begin());
+        
+        if (r->GetNormalFlag() && !(r->GetOneShotFlag()))
+        {
+            if (!(r->GetLock()))
+            {
+                _debug->PageLockFailed(r->GetPageNumber(), true, r->GetUntransmitted()); // this extra transmission is lost
+                continue;
+            }
+            if (!(r->GetIsMarked()) && !(r->Special()) && !(r->IsCarousel()) && r->GetSubpageCount() > 0)
+                return r; // return page locked
+            r->FreeLock();
+        }
+    }
+    
     if (_page == nullptr)
     {
         _iter=_NormalPagesList.begin();
@@ -96,8 +116,22 @@ std::shared_ptr<TTXPageStream> NormalPages::NextPage()
                 {
                     ++_iter;
                 }
+                else if (_page->SkipCycle()) // page is only sent every few cycles
+                {
+                    ++_iter;
+                }
                 else
                 {
+                    _position++;
+                    
+                    // space out any extra transmissions evenly through the following cycle. Carousels are not repeated as it would step them.
+                    int repeat = _page->GetRepeat();
+                    if (repeat > 1 && !(_page->IsCarousel()))
+                    {
+                        for (int i=1; i<repeat; i++)
+                            _repeats.insert(std::make_pair(_position + (i * _NormalPagesList.size()) / repeat, _page));
+                    }
+                    
                     return _page; // return page locked
                 }
                 
@@ -106,7 +140,8 @@ std::shared_ptr<TTXPageStream> NormalPages::NextPage()
             }
             else
             {
-                // skip page
+                // skip page until next cycle
+                _debug->PageLockFailed(_page->GetPageNumber(), true, _page->GetUntransmitted());
                 ++_iter;
                 _page = *_iter;
             }
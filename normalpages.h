@@ -2,6 +2,7 @@
 #define _NORMALPAGES_H
 
 #include <list>
+#include <map>
 #include <mutex>
 
 #include "debug.h"
@@ -34,6 +35,9 @@ class NormalPages
         std::list<std::shared_ptr<TTXPageStream>> _NormalPagesList;
         std::list<std::shared_ptr<TTXPageStream>>::iterator _iter;
         std::shared_ptr<TTXPageStream> _page;
+        
+        std::size_t _position; // count of pages sent from the list, used to space out repeats
+        std::multimap<std::size_t, std::shared_ptr<TTXPageStream>> _repeats; // extra transmissions keyed by position
 };
 
 }
@@ -3,7 +3,7 @@
 
 using namespace vbit;
 
-Packet::Packet(int mag, int row) : _isHeader(false), _coding(CODING_7BIT_TEXT)
+Packet::Packet(int mag, int row) : _isHeader(false), _coding(CODING_7BIT_TEXT), _substitute(true), _txReady(false)
 {
     //ctor
     _packet.fill(0x20); // fill with spaces
@@ -24,6 +24,7 @@ void Packet::SetRow(int mag, int row, std::array<uint8_t, 40> val, PageCoding co
     std::copy(val.begin(), val.end(), _packet.begin() + 5);
     
     _coding = coding;
+    _substitute = true;
     
     switch(coding)
     {
@@ -132,6 +133,37 @@ void Packet::SetRow(int mag, int row, std::array<uint8_t, 40> val, PageCoding co
     }
 }
 
+void Packet::SetRow(int mag, int row, std::shared_ptr<TTXLine> line, PageCoding coding)
+{
+    std::shared_ptr<const TTXLine::Encoded> encoded = line->GetEncoded();
+    
+    if (encoded == nullptr || encoded->requested != coding)
+    {
+        SetRow(mag, row, line->GetLine(), coding);
+        
+        // cache the encoded row for the next packet using this line
+        std::shared_ptr<TTXLine::Encoded> e(new TTXLine::Encoded);
+        e->requested = coding;
+        e->coding = _coding;
+        e->substitute = false;
+        std::copy_n(_packet.begin() + 5, 40, e->data.begin());
+        for (int i=5; i<PACKETSIZE; i++)
+        {
+            if ((_packet[i] & 0x7f) == '%')
+                e->substitute = true;
+        }
+        _substitute = e->substitute;
+        line->SetEncoded(e);
+        return;
+    }
+    
+    SetMRAG(mag, row);
+    _isHeader=false;
+    std::copy(encoded->data.begin(), encoded->data.end(), _packet.begin() + 5);
+    _coding = (PageCoding)encoded->coding;
+    _substitute = encoded->substitute;
+}
+
 void Packet::SetX27CRC(uint16_t crc)
 {
     if (Hamming8DecodeTable[_packet[5]] == 0) // only set CRC bytes for packet X/27/0
@@ -148,6 +180,14 @@ void Packet::SetPacketRaw(std::vector<uint8_t> data)
     _coding = CODING_8BIT_DATA; // don't allow this to be re-processed with parity etc
 }
 
+void Packet::SetTxPacket(const std::array<uint8_t, PACKETSIZE> &data)
+{
+    _packet = data;
+    _isHeader = false;
+    _coding = CODING_8BIT_DATA; // already encoded so tx() must leave it alone
+    _txReady = true;
+}
+
 // Set CRI and MRAG. Leave the rest of the packet alone
 void Packet::SetMRAG(uint8_t mag, uint8_t row)
 {
@@ -160,6 +200,7 @@ void Packet::SetMRAG(uint8_t mag, uint8_t row)
     _isHeader=row==0;
     _row=row;
     _mag=mag;
+    _txReady=false;
 }
 
 /** get_offset_time.
@@ -172,7 +213,7 @@ bool Packet::get_offset_time(time_t t, uint8_t* str)
 {
     char strTime[6];
     time_t rawtime = t;
-    struct tm *tmGMT;
+    struct tm tmGMT;
 
     // What is our offset in seconds?
     int offset=((str[3]-'0')*10+str[4]-'0')*30*60; // @todo We really ought to validate this
@@ -186,9 +227,13 @@ bool Packet::get_offset_time(time_t t, uint8_t* str)
     // Add the offset to the time value
     rawtime+=offset;
 
-    tmGMT = gmtime(&rawtime);
+    #ifdef WIN32
+    gmtime_s(&tmGMT, &rawtime);
+    #else
+    gmtime_r(&rawtime, &tmGMT);
+    #endif
 
-    strftime(strTime, 21, "%H:%M", tmGMT);
+    strftime(strTime, 21, "%H:%M", &tmGMT);
     std::copy_n(strTime,5,str);
     return true;
 }
@@ -209,13 +254,19 @@ int Packet::GetOffsetOfSubstition(std::string string)
  */
 std::array<uint8_t, PACKETSIZE>* Packet::tx()
 {
+    if (_txReady)
+        return &_packet; // copied in by SetTxPacket
+    
     // get master clock singleton
-    MasterClock *mc = mc->Instance();
-    time_t t = mc->GetMasterClock().seconds;
+    time_t t = MasterClock::Instance()->GetSeconds();
     
     // Get local time
-    struct tm * timeinfo;
-    timeinfo=localtime(&t);
+    struct tm timeinfo; // localtime() isn't thread safe and magazines may be generated in parallel
+    #ifdef WIN32
+    localtime_s(&timeinfo, &t);
+    #else
+    localtime_r(&t, &timeinfo);
+    #endif
     
     char tmpstr[21];
     int off;
@@ -224,7 +275,7 @@ std::array<uint8_t, PACKETSIZE>* Packet::tx()
     {
         // substitutions already done in HeaderText
     }
-    else if (_row < 26 && _coding == CODING_7BIT_TEXT) // Other text rows
+    else if (_row < 26 && _coding == CODING_7BIT_TEXT && _substitute) // Other text rows
     {
         for (int i=5;i<45;i++) _packet[i] &= 0x7f; // strip parity bits off
         // ======= TEMPERATURE ========
@@ -275,7 +326,7 @@ std::array<uint8_t, PACKETSIZE>* Packet::tx()
         off = Packet::GetOffsetOfSubstition("%%%%%%%%%%%%timedate");
         if (off > -1)
         {
-            int num = strftime(tmpstr, 21, "\x02%a %d %b\x03%H:%M/%S", timeinfo);
+            int num = strftime(tmpstr, 21, "\x02%a %d %b\x03%H:%M/%S", &timeinfo);
             std::copy_n(tmpstr,num,_packet.begin() + off);
         }
         
@@ -331,12 +382,15 @@ void Packet::Header(uint8_t mag, uint8_t page, uint16_t subcode, uint16_t contro
     // perform the header template substitutions for page number, date, etc.
     
     // get master clock singleton
-    MasterClock *mc = mc->Instance();
-    time_t t = mc->GetMasterClock().seconds;
+    time_t t = MasterClock::Instance()->GetSeconds();
     
     // Get local time
-    struct tm * timeinfo;
-    timeinfo=localtime(&t);
+    struct tm timeinfo;
+    #ifdef WIN32
+    localtime_s(&timeinfo, &t);
+    #else
+    localtime_r(&t, &timeinfo);
+    #endif
     
     char tmpstr[4];
     int off;
@@ -362,7 +416,7 @@ void Packet::Header(uint8_t mag, uint8_t page, uint16_t subcode, uint16_t contro
     off = Packet::GetOffsetOfSubstition("%%a");
     if (off > -1)
     {
-        int num = strftime(tmpstr,4,"%a",timeinfo);
+        int num = strftime(tmpstr,4,"%a",&timeinfo);
         if (num){
             _packet[off]=tmpstr[0];
             _packet[off+1]=(num > 1)?tmpstr[1]:' ';
@@ -374,7 +428,7 @@ void Packet::Header(uint8_t mag, uint8_t page, uint16_t subcode, uint16_t contro
     off = Packet::GetOffsetOfSubstition("%%b");
     if (off > -1)
     {
-        int num = strftime(tmpstr,4,"%b",timeinfo);
+        int num = strftime(tmpstr,4,"%b",&timeinfo);
         if (num){
             _packet[off]=tmpstr[0];
             _packet[off+1]=(num > 1)?tmpstr[1]:' ';
@@ -386,7 +440,7 @@ void Packet::Header(uint8_t mag, uint8_t page, uint16_t subcode, uint16_t contro
     off = Packet::GetOffsetOfSubstition("%d");
     if (off > -1)
     {
-        strftime(tmpstr,3,"%d",timeinfo);
+        strftime(tmpstr,3,"%d",&timeinfo);
         _packet[off]=tmpstr[0];
         _packet[off+1]=tmpstr[1];
     }
@@ -396,7 +450,7 @@ void Packet::Header(uint8_t mag, uint8_t page, uint16_t subcode, uint16_t contro
     if (off > -1)
     {
         // windows doesn't support %e so just use %d and blank leading zero
-        strftime(tmpstr,3,"%d",timeinfo);
+        strftime(tmpstr,3,"%d",&timeinfo);
         if (tmpstr[0] == '0')
             _packet[off]=' ';
         else
@@ -408,7 +462,7 @@ void Packet::Header(uint8_t mag, uint8_t page, uint16_t subcode, uint16_t contro
     off = Packet::GetOffsetOfSubstition("%m");
     if (off > -1)
     {
-        strftime(tmpstr,10,"%m",timeinfo);
+        strftime(tmpstr,10,"%m",&timeinfo);
         _packet[off]=tmpstr[0];
         _packet[off+1]=tmpstr[1];
     }
@@ -417,7 +471,7 @@ void Packet::Header(uint8_t mag, uint8_t page, uint16_t subcode, uint16_t contro
     off = Packet::GetOffsetOfSubstition("%y");
     if (off > -1)
     {
-        strftime(tmpstr,10,"%y",timeinfo);
+        strftime(tmpstr,10,"%y",&timeinfo);
         _packet[off]=tmpstr[0];
         _packet[off+1]=tmpstr[1];
     }
@@ -426,7 +480,7 @@ void Packet::Header(uint8_t mag, uint8_t page, uint16_t subcode, uint16_t contro
     off = Packet::GetOffsetOfSubstition("%H");
     if (off > -1)
     {
-        strftime(tmpstr,10,"%H",timeinfo);
+        strftime(tmpstr,10,"%H",&timeinfo);
         _packet[off]=tmpstr[0];
         _packet[off+1]=tmpstr[1];
     }
@@ -435,7 +489,7 @@ void Packet::Header(uint8_t mag, uint8_t page, uint16_t subcode, uint16_t contro
     off = Packet::GetOffsetOfSubstition("%M");
     if (off > -1)
     {
-        strftime(tmpstr,10,"%M",timeinfo);
+        strftime(tmpstr,10,"%M",&timeinfo);
         _packet[off]=tmpstr[0];
         _packet[off+1]=tmpstr[1];
     }
@@ -444,7 +498,7 @@ void Packet::Header(uint8_t mag, uint8_t page, uint16_t subcode, uint16_t contro
     off = Packet::GetOffsetOfSubstition("%S");
     if (off > -1)
     {
-        strftime(tmpstr,10,"%S",timeinfo);
+        strftime(tmpstr,10,"%S",&timeinfo);
         _packet[off]=tmpstr[0];
         _packet[off+1]=tmpstr[1];
     }
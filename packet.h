@@ -39,11 +39,20 @@ namespace vbit
              */
             void SetPacketRaw(std::vector<uint8_t> data);
             
+            /** SetTxPacket
+             * Copy in a whole packet which has already been through tx()
+             * \param data 45 byte transmission ready packet
+             */
+            void SetTxPacket(const std::array<uint8_t, PACKETSIZE> &data);
+            
             /** tx
              * @return pointer to packet data vector
              * We create transmission ready packets of 45 bytes.
              */
             std::array<uint8_t, PACKETSIZE>* tx();
+            
+            /** @return true if the packet was copied in by SetTxPacket, so tx() has nothing to do */
+            bool IsTxReady(){return _txReady;};
 
             /** SetMRAG
              * Sets the first five bytes of the packet
@@ -110,6 +119,12 @@ namespace vbit
              */
             void SetRow(int mag, int row, std::array<uint8_t, 40> val, PageCoding coding);
             
+            /**
+             * @brief As above, but reuses the encoding cached on the line when it has one
+             * @param line - The row (40 characters). Its contents must not change.
+             */
+            void SetRow(int mag, int row, std::shared_ptr<TTXLine> line, PageCoding coding);
+            
             /** PacketCRC
              * Set the 16 byte CRC in X/27/0 packets
              * @param crc intial crc value
@@ -130,6 +145,8 @@ namespace vbit
             uint8_t _mag;//<! The magazine number this packet belongs to 0..7 where 0 is maazine 8
             uint8_t _row; //<! Row number 0 to 31
             PageCoding _coding; // packet coding
+            bool _substitute; // row may contain substitutions for tx()
+            bool _txReady; // already through tx()
             
             int GetOffsetOfSubstition(std::string string);
             
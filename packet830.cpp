@@ -20,8 +20,7 @@ Packet830::~Packet830()
 
 Packet* Packet830::GetPacket(Packet* p)
 {
-    MasterClock *mc = mc->Instance();
-    time_t timeRaw = mc->GetMasterClock().seconds;
+    time_t timeRaw = MasterClock::Instance()->GetSeconds();
     time_t timeLocal;
     struct tm *tmLocal;
     struct tm *tmGMT;
@@ -236,7 +236,7 @@ bool PacketDatacast::IsReady(bool force)
             // push IDL B packets to packet buffer
             // TODO: this will hog buffer - should maybe try to share a bit better
             Packet* p = GetFreeBuffer();
-            while (p != nullptr)
+            while (p != nullptr && _IDLBState == IDLBStateLoaded) // stop after the last row of the bundle
             {
                 p->SetPacketRaw(std::vector<uint8_t>(_IDLBPacketBlock.begin()+40*_IDLBNextRow, _IDLBPacketBlock.begin()+40*_IDLBNextRow+40));
                 _head = (_head + 1) % _bufferSize; // advance head on circular buffer
@@ -264,3 +264,11 @@ bool PacketDatacast::IsReady(bool force)
     
     return result;
 }
+
+int PacketDatacast::GetBufferOccupancy()
+{
+    // the two ends are moved by different threads, so this is a snapshot
+    int head = _head;
+    int tail = _tail;
+    return (head - tail + _bufferSize) % _bufferSize;
+}
@@ -2,6 +2,7 @@
 #define PACKETDATACAST_H
 
 #include <mutex>
+#include <atomic>
 #include "packetsource.h"
 #include "configure.h"
 #include "tables.h"
@@ -17,6 +18,8 @@ namespace vbit
             Packet* GetPacket(Packet* p) override;
             bool IsReady(bool force=false);
             
+            int GetBufferOccupancy(); // packets waiting to be sent
+            
             int PushRaw(std::vector<uint8_t> *data);
             int PushIDLA(uint8_t flags, uint8_t ial, uint32_t spa, uint8_t ri, uint8_t ci, std::vector<uint8_t> *data);
             int PushIDLBHalf(bool halfFlag, uint8_t an, uint8_t ai, std::array<uint8_t, 245> *data);
@@ -27,8 +30,8 @@ namespace vbit
             
             std::vector<Packet*> _packetBuffer;
             uint8_t _bufferSize;
-            uint8_t _head;
-            uint8_t _tail;
+            std::atomic<uint8_t> _head; // moved by the interface thread, or the service thread for IDL B
+            std::atomic<uint8_t> _tail; // moved by the service thread
             
             Packet* GetFreeBuffer();
             
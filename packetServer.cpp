@@ -8,7 +8,8 @@ PacketServer::PacketServer(Configure *configure, Debug *debug) :
     _debug(debug),
     _portNumber(configure->GetPacketServerPort()),
     _maxClients(configure->GetPacketServerMaxClients()),
-    _isActive(false)
+    _isActive(false),
+    _clientCount(0)
 {
     /* initialise sockets */
     _serverSock = -1;
@@ -168,6 +169,7 @@ void PacketServer::run()
                 FD_SET(*it , &readfds);
         }
         _isActive = !(_clientSocks.empty());
+        _clientCount = _clientSocks.size();
         
         /* wait for activity on any socket */
         if ((select(FD_SETSIZE, &readfds, NULL, NULL, NULL) < 0) && (errno!=EINTR))
@@ -4,6 +4,7 @@
 #include "configure.h"
 #include "debug.h"
 #include <mutex>
+#include <atomic>
 #include <list>
 
 #ifdef WIN32
@@ -27,6 +28,7 @@ namespace vbit
             
             void run();
             bool GetIsActive(){return _isActive;}; /* is the packet server running? */
+            int GetClientCount(){return _clientCount;}; /* connected clients */
             void SendField(std::vector<std::vector<uint8_t>> FrameBuffer);
             
         private:
@@ -42,6 +44,7 @@ namespace vbit
             uint16_t _maxClients;
             
             bool _isActive;
+            std::atomic<int> _clientCount;
             
             void DieWithError(std::string errorMessage); // handle fatal socket errors
     };
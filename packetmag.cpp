@@ -45,6 +45,12 @@ PacketMag::~PacketMag()
 }
 
 Packet* PacketMag::GetPacket(Packet* p)
+{
+    StageTimer timer(_debug->GetHistogram(Debug::stageGETPACKET));
+    return _getPacket(p);
+}
+
+Packet* PacketMag::_getPacket(Packet* p)
 {
     unsigned int thisSubcode;
     bool updatedFlag=false;
@@ -63,6 +69,7 @@ loopback: // jump back point to avoid returning null packets when we could send
         case PACKETSTATE_HEADER: // Start to send out a new page, which may be a simple page or one of a carousel
         {
             _waitingForField = true; // enforce 20ms page erasure interval
+            _debug->SetUpdatedPagesQueued(_magNumber, _updatedPages->Size());
             if (GetEvent(EVENT_PACKET_29) && _packet29 != nullptr)
             {
                 if (_mtx.try_lock()) // skip if unable to get lock
@@ -81,6 +88,10 @@ loopback: // jump back point to avoid returning null packets when we could send
                     }
                     _mtx.unlock(); // we got a lock so unlock again
                 }
+                else
+                {
+                    _debug->PacketLockFailed(_magNumber); // the event stays set so try again at the next header
+                }
             }
             _specialPagesFlipFlop = !_specialPagesFlipFlop; // toggle the flag so that we interleave special pages and regular pages during the special pages event so that rolling headers aren't stopped completely
             if (GetEvent(EVENT_SPECIAL_PAGES) && _specialPagesFlipFlop)
@@ -148,8 +159,7 @@ loopback: // jump back point to avoid returning null packets when we could send
                 {
                     // reached the end of a magazine cycle
                     // get master clock singleton
-                    MasterClock *mc = mc->Instance();
-                    MasterClock::timeStruct t = mc->GetMasterClock();
+                    MasterClock::timeStruct t = MasterClock::Instance()->GetMasterClock();
                     if (_lastCycleTimestamp.seconds){ // wait for real timestamps
                         // calculate time since magazine cycle started
                         int diffSeconds = difftime(t.seconds, _lastCycleTimestamp.seconds); // truncates double to int
@@ -242,6 +252,10 @@ loopback: // jump back point to avoid returning null packets when we could send
                 goto loopback;
             }
             
+            int64_t gap = _page->Transmitted();
+            if (gap)
+                _debug->PageGap(_page->GetPageNumber(), gap);
+            
             // clear a flag we use to prevent duplicated X/28/0 packets
             _hasX28Region = false;
             p->Header(_magNumber,_page->GetPageNumber(),thisSubcode,_status,_hasCustomHeader?_customHeaderTemplate:_configure->GetHeaderTemplate());
@@ -257,7 +271,7 @@ loopback: // jump back point to avoid returning null packets when we could send
                 Packet TempPacket(8,25); // a temporary packet for checksum calculation
                 for (int i=1; i<26; i++)
                 {
-                    TempPacket.SetRow(_magNumber, _thisRow, _subpage->GetRow(i)->GetLine(), _subpage->GetRow(i)->IsBlank()?CODING_7BIT_TEXT:_page->GetPageCoding());
+                    TempPacket.SetRow(_magNumber, _thisRow, _subpage->GetRow(i), _subpage->GetRow(i)->IsBlank()?CODING_7BIT_TEXT:_page->GetPageCoding());
                     tempCRC = TempPacket.PacketCRC(tempCRC);
                 }
                 
@@ -268,7 +282,7 @@ loopback: // jump back point to avoid returning null packets when we could send
             
             assert(p!=NULL);
             
-            _lastTxt=_page->GetTxRow(27); // Get _lastTxt ready for packet 27 processing
+            _lastTxt=_subpage->GetRow(27); // Get _lastTxt ready for packet 27 processing
             _state=PACKETSTATE_PACKET27;
             break;
         }
@@ -277,20 +291,20 @@ loopback: // jump back point to avoid returning null packets when we could send
             if (_lastTxt)
             {
                 if ((_lastTxt->GetCharAt(0) & 0xF) > 3) // designation codes > 3
-                    p->SetRow(_magNumber, 27, _lastTxt->GetLine(), CODING_13_TRIPLETS); // enhancement linking
+                    p->SetRow(_magNumber, 27, _lastTxt, CODING_13_TRIPLETS); // enhancement linking
                 else if ((_lastTxt->GetCharAt(1) & _lastTxt->GetCharAt(2) & _lastTxt->GetCharAt(7) & _lastTxt->GetCharAt(8) &
                          _lastTxt->GetCharAt(13) & _lastTxt->GetCharAt(14) & _lastTxt->GetCharAt(19) & _lastTxt->GetCharAt(20) &
                          _lastTxt->GetCharAt(25) & _lastTxt->GetCharAt(26) & _lastTxt->GetCharAt(31) & _lastTxt->GetCharAt(32)) != 0xf)
                          // don't generate packet if all page links are 0xFF
                 {
-                    p->SetRow(_magNumber, 27, _lastTxt->GetLine(), CODING_HAMMING_8_4); // navigation packets
+                    p->SetRow(_magNumber, 27, _lastTxt, CODING_HAMMING_8_4); // navigation packets
                     if ((_lastTxt->GetCharAt(0) & 0xF) == 0) // only designation code 0 has CRC
                         p->SetX27CRC(_subpage->GetSubpageCRC());
                 }
                 _lastTxt=_lastTxt->GetNextLine();
                 break;
             }
-            _lastTxt=_page->GetTxRow(28); // Get _lastTxt ready for packet 28 processing
+            _lastTxt=_subpage->GetRow(28); // Get _lastTxt ready for packet 28 processing
             _state=PACKETSTATE_PACKET28; //  // Intentional fall through to PACKETSTATE_PACKET28
             /* fallthrough */
             [[gnu::fallthrough]];
@@ -299,7 +313,7 @@ loopback: // jump back point to avoid returning null packets when we could send
         {
             if (_lastTxt)
             {
-                p->SetRow(_magNumber, 28, _lastTxt->GetLine(), CODING_13_TRIPLETS);
+                p->SetRow(_magNumber, 28, _lastTxt, CODING_13_TRIPLETS);
                 if ((_lastTxt->GetCharAt(0) & 0xF) == 0 || (_lastTxt->GetCharAt(0) & 0xF) == 4)
                     _hasX28Region = true; // don't generate an X/28/0 for a RE line
                 _lastTxt=_lastTxt->GetNextLine();
@@ -323,14 +337,14 @@ loopback: // jump back point to avoid returning null packets when we could send
                 val[2] = ((triplet & 0xFC0) >> 6) | 0x40;
                 val[3] = ((triplet & 0x3F000) >> 12) | 0x40;
                 p->SetRow(_magNumber, 28, val, CODING_13_TRIPLETS);
-                _lastTxt=_page->GetTxRow(26); // Get _lastTxt ready for packet 26 processing
+                _lastTxt=_subpage->GetRow(26); // Get _lastTxt ready for packet 26 processing
                 _state=PACKETSTATE_PACKET26;
                 break;
             }
             else if (_page->GetPageCoding() == CODING_7BIT_TEXT)
             {
                 // X/26 packets next in normal pages
-                _lastTxt=_page->GetTxRow(26); // Get _lastTxt ready for packet 26 processing
+                _lastTxt=_subpage->GetRow(26); // Get _lastTxt ready for packet 26 processing
                 _state=PACKETSTATE_PACKET26; // Intentional fall through to PACKETSTATE_PACKET26
             }
             else
@@ -346,7 +360,7 @@ loopback: // jump back point to avoid returning null packets when we could send
         {
             if (_lastTxt)
             {
-                p->SetRow(_magNumber, 26, _lastTxt->GetLine(), CODING_13_TRIPLETS);
+                p->SetRow(_magNumber, 26, _lastTxt, CODING_13_TRIPLETS);
                 // Do we have another line?
                 _lastTxt=_lastTxt->GetNextLine();
                 break;
@@ -372,7 +386,7 @@ loopback: // jump back point to avoid returning null packets when we could send
             // Find the next row that isn't NULL
             for (_thisRow++;_thisRow<26;_thisRow++)
             {
-                _lastTxt=_page->GetTxRow(_thisRow);
+                _lastTxt=_subpage->GetRow(_thisRow);
                 if (_lastTxt!=NULL)
                     break;
             }
@@ -390,7 +404,7 @@ loopback: // jump back point to avoid returning null packets when we could send
                 else
                 {
                     // otherwise go on to X/26
-                    _lastTxt=_page->GetTxRow(26);
+                    _lastTxt=_subpage->GetRow(26);
                     _state=PACKETSTATE_PACKET26;
                 }
                 goto loopback;
@@ -405,7 +419,7 @@ loopback: // jump back point to avoid returning null packets when we could send
                 else
                 {
                     // Assemble the packet
-                    p->SetRow(_magNumber, _thisRow, _lastTxt->GetLine(), _page->GetPageCoding());
+                    p->SetRow(_magNumber, _thisRow, _lastTxt, _page->GetPageCoding());
                     assert(p->IsHeader()!=true);
                 }
             }
@@ -451,8 +465,7 @@ bool PacketMag::IsReady(bool force)
         {
             _waitingForSecond = false;
             // get master clock singleton
-            MasterClock *mc = mc->Instance();
-            MasterClock::timeStruct t = mc->GetMasterClock();
+            MasterClock::timeStruct t = MasterClock::Instance()->GetMasterClock();
             // calculate time since last time filling header and add to cycle time measured there
             int diffSeconds = difftime(t.seconds, _lastCycleTimestamp.seconds); // truncates double to int
             _cycleDuration += ((diffSeconds * 50) - _lastCycleTimestamp.fields) + t.fields;
@@ -2,6 +2,7 @@
 #define PACKETMAG_H
 #include <list>
 #include <mutex>
+#include <atomic>
 #include <memory>
 #include <packetsource.h>
 #include "ttxpagestream.h"
@@ -35,8 +36,14 @@ namespace vbit
             Packet* GetPacket(Packet* p) override;
 
             void SetPriority(uint8_t priority) { _priority = priority; }
+            uint8_t GetPriority() { return _priority; }
 
             bool IsReady(bool force=false);
+            
+            /** @return true if a header has been sent and the magazine must wait for the next field */
+            bool IsWaitingForField() { return _waitingForField; };
+            /** @return true if the magazine has finished a cycle and is holding back until the next second */
+            bool IsWaitingForSecond() { return _waitingForSecond; };
 
             void SetPacket29(std::shared_ptr<TTXLine> line);
             std::shared_ptr<TTXLine> GetPacket29() { return _packet29; }
@@ -49,12 +56,17 @@ namespace vbit
             
             void InvalidateCycleTimestamp() { _lastCycleTimestamp = {0,0}; }; // reset cycle duration calculation
             int GetCycleDuration() { return _cycleDuration; };
+            
+            /** @return true if this magazine is part way through sending page, and so holds its lock */
+            bool IsSending(std::shared_ptr<TTXPageStream> page) { return _state != PACKETSTATE_HEADER && _page == page; };
 
         protected:
 
         private:
             enum PacketState {PACKETSTATE_HEADER, PACKETSTATE_PACKET26, PACKETSTATE_PACKET27, PACKETSTATE_PACKET28, PACKETSTATE_TEXTROW};
             
+            Packet* _getPacket(Packet* p); // GetPacket, untimed
+            
             PageList* _pageList;
             Configure* _configure;
             Debug* _debug;
@@ -85,8 +97,8 @@ namespace vbit
             int _region;
             bool _hasX28Region;
             bool _specialPagesFlipFlop; // toggle to alternate between special pages and normal pages
-            bool _waitingForField;
-            bool _waitingForSecond;
+            std::atomic<bool> _waitingForField; // also read by the service thread when a producer runs this magazine
+            std::atomic<bool> _waitingForSecond;
             
             MasterClock::timeStruct _lastCycleTimestamp;
             int _cycleDuration; // magazine cycle time in fields
@@ -57,7 +57,7 @@ class PacketSource
     virtual bool IsReady(bool force=false)=0;
 
     /** Report that an event happened */
-    void SetEvent(Event event); // All packet sources can use the same code
+    virtual void SetEvent(Event event); // All packet sources can use the same code
     void ClearEvent(Event event){_eventList[event]=false;}; // All packet sources can use the same code
     bool GetEvent(Event event){return _eventList[event];};
 
@@ -1,9 +1,13 @@
  #include "page.h"
+#include "rowStore.h"
+#include "hash.h"
 
 using namespace vbit;
 
 Page::Page() :
-    _carouselPage(nullptr)
+    _cursor(0),
+    _carouselPage(nullptr),
+    _subcodeIndexValid(false)
 {
     ClearPage(); // initialises variables
 }
@@ -18,6 +22,7 @@ void Page::AppendSubpage(std::shared_ptr<Subpage> s)
     s->SetMagazine(_pageNumber >> 8); // tell subpage what magazine it is in for fastext
     
     _subpages.push_back(s);
+    _subcodeIndexValid = false;
     if (_carouselPage == nullptr)
         StepFirstSubpage();
 }
@@ -26,34 +31,26 @@ void Page::InsertSubpage(std::shared_ptr<Subpage> s)
 {
     s->SetMagazine(_pageNumber >> 8); // tell subpage what magazine it is in for fastext
     
-    for (std::list<std::shared_ptr<Subpage>>::iterator it=_subpages.begin();it!=_subpages.end();++it)
-    {
-        // find first subpage with a higher subcode
-        std::shared_ptr<Subpage> ptr = *it;
-        if (ptr->GetSubCode() > s->GetSubCode())
-        {
-            _subpages.insert(it,s);
-            return;
-        }
-    }
+    // find first subpage with a higher subcode
+    std::vector<std::shared_ptr<Subpage>>::iterator it = std::upper_bound(_subpages.begin(), _subpages.end(), s,
+        [](const std::shared_ptr<Subpage>& a, const std::shared_ptr<Subpage>& b){ return a->GetSubCode() < b->GetSubCode(); });
+    
+    std::size_t index = it - _subpages.begin();
+    _subpages.insert(it, s);
+    _subcodeIndexValid = false;
     
-    // if we are here we ran to the end of the list without a match
-    _subpages.push_back(s);
     if (_carouselPage == nullptr)
         StepFirstSubpage();
+    else if (index <= _cursor)
+        _cursor++; // keep the cursor on the same subpage
 }
 
 void Page::RemoveSubpage(std::shared_ptr<Subpage> s)
 {
-    _subpages.remove(s);
+    _subpages.erase(std::remove(_subpages.begin(), _subpages.end(), s), _subpages.end());
+    _subcodeIndexValid = false;
     
-    if (_subpages.empty())
-        _carouselPage = nullptr;
-    else
-    {
-        _iter=_subpages.begin();
-        _carouselPage = *_iter;
-    }
+    StepFirstSubpage();
 }
 
 void Page::ClearPage()
@@ -61,10 +58,34 @@ void Page::ClearPage()
     _pageNumber = 0; // an invalid page number
     _pageCoding=CODING_7BIT_TEXT;
     _pageFunction=LOP;
+    _repeat=1; // once per magazine cycle
     _carouselPage=nullptr;
     
     _subpages.clear(); // empty subpage list
-    _iter=_subpages.begin(); // reset iterator
+    _cursor = 0; // reset cursor
+    _subcodeIndexValid = false;
+}
+
+int Page::ReuseSubpages(Page &page)
+{
+    int changed = 0;
+    for (std::size_t i=0; i<_subpages.size(); i++)
+    {
+        std::shared_ptr<Subpage> s = page.LocateSubpage(_subpages[i]->GetSubCode());
+        if (s && s->ContentHash() == _subpages[i]->ContentHash())
+        {
+            if (_carouselPage == _subpages[i])
+                _carouselPage = s;
+            _subpages[i] = s;
+        }
+        else
+        {
+            changed++;
+            if (s)
+                _subpages[i]->ReuseRows(*s);
+        }
+    }
+    return changed;
 }
 
 void Page::RenumberSubpages()
@@ -89,8 +110,7 @@ void Page::RenumberSubpages()
     {
         // Page has subpages. Renumber according to Annex A.1.
         for (int i=0;i<4;i++) code[i]=0;
-        std::list<std::shared_ptr<Subpage>>::iterator it;
-        for (it = _subpages.begin(); it != _subpages.end(); ++it)
+        for (auto it = _subpages.begin(); it != _subpages.end(); ++it)
         {
             if (Special())
             {
@@ -134,6 +154,7 @@ void Page::RenumberSubpages()
             count++;
         }
     }
+    _subcodeIndexValid = false;
 }
 
 void Page::SetPageNumber(int page)
@@ -261,14 +282,14 @@ bool Page::IsCarousel()
 
 void Page::StepFirstSubpage()
 {
+    _cursor = 0;
     if (_subpages.empty())
     {
         _carouselPage = nullptr;
     }
     else
     {
-        _iter=_subpages.begin();
-        _carouselPage = *_iter;
+        _carouselPage = _subpages[_cursor];
     }
 }
 
@@ -276,12 +297,13 @@ void Page::StepLastSubpage()
 {
     if (_subpages.empty())
     {
+        _cursor = 0;
         _carouselPage = nullptr;
     }
     else
     {
-        _iter=_subpages.end();
-        _carouselPage = *--_iter;
+        _cursor = _subpages.size() - 1;
+        _carouselPage = _subpages[_cursor];
     }
 }
 
@@ -289,33 +311,28 @@ void Page::StepNextSubpageNoLoop()
 {
     if (_subpages.empty())
     {
+        _cursor = 0;
         _carouselPage = nullptr;
+        return;
     }
+    
+    if (_carouselPage==nullptr)
+        _cursor = 0;
     else
+        _cursor++;
+    
+    // skip over subpages if transmit flag not set
+    while (_cursor < _subpages.size() && !(_subpages[_cursor]->GetSubpageStatus() & PAGESTATUS_TRANSMITPAGE))
+        _cursor++;
+    
+    if (_cursor < _subpages.size())
     {
-        if (_carouselPage==nullptr)
-        {
-            _iter=_subpages.begin();
-        }
-        else
-        {
-            ++_iter;
-        }
-        
-        if (_iter == _subpages.end())
-        {
-            _carouselPage = nullptr;
-        }
-        else
-        {
-            _carouselPage = *_iter;
-        }
-        
-        if (_carouselPage != nullptr)
-        {
-            if (!(_carouselPage->GetSubpageStatus() & PAGESTATUS_TRANSMITPAGE))
-                StepNextSubpageNoLoop(); // skip over subpages if transmit flag not set
-        }
+        _carouselPage = _subpages[_cursor];
+    }
+    else
+    {
+        _cursor = _subpages.size(); // past the end
+        _carouselPage = nullptr;
     }
 }
 
@@ -323,23 +340,21 @@ void Page::StepNextSubpage()
 {
     if (_subpages.empty())
     {
+        _cursor = 0;
         _carouselPage = nullptr;
     }
     else
     {
         if (_carouselPage==nullptr)
         {
-            _iter=_subpages.begin();
-            _carouselPage = *_iter;
+            _cursor = 0;
         }
         else
         {
-            if (_iter == _subpages.end())
-                _iter = _subpages.begin();
-            if (++_iter == _subpages.end())
-                _iter = _subpages.begin();
-            _carouselPage = *_iter;
+            if (++_cursor >= _subpages.size())
+                _cursor = 0;
         }
+        _carouselPage = _subpages[_cursor];
         
         if (!(_carouselPage->GetSubpageStatus() & PAGESTATUS_TRANSMITPAGE))
         {
@@ -348,14 +363,33 @@ void Page::StepNextSubpage()
     }
 }
 
+void Page::RebuildSubcodeIndex()
+{
+    _subcodeIndex.clear();
+    for (std::size_t i = 0; i < _subpages.size(); i++)
+    {
+        _subcodeIndex.insert(std::make_pair(_subpages[i]->GetSubCode(), i)); // keeps the first subpage with a given subcode
+    }
+    _subcodeIndexValid = true;
+}
+
 // Find a subpage by subcode - Warning: this will only find the first match so don't let multiples into the list!
 std::shared_ptr<Subpage> Page::LocateSubpage(uint16_t SubpageNumber)
 {
-    for (std::list<std::shared_ptr<Subpage>>::iterator s=_subpages.begin();s!=_subpages.end();++s)
+    for (int attempt = 0; attempt < 2; attempt++)
     {
-        std::shared_ptr<Subpage> ptr = *s;
-        if (SubpageNumber==ptr->GetSubCode())
+        if (!_subcodeIndexValid)
+            RebuildSubcodeIndex();
+        
+        std::map<uint16_t, std::size_t>::iterator it = _subcodeIndex.find(SubpageNumber);
+        if (it == _subcodeIndex.end())
+            return nullptr;
+        
+        std::shared_ptr<Subpage> ptr = _subpages[it->second];
+        if (ptr->GetSubCode() == SubpageNumber)
             return ptr;
+        
+        _subcodeIndexValid = false; // a subcode was changed directly so the entry is stale, try again with a fresh index
     }
     return nullptr;
 }
@@ -364,7 +398,10 @@ std::shared_ptr<Subpage> Page::LocateSubpage(uint16_t SubpageNumber)
 void Page::SetSubpage(uint16_t SubpageNumber)
 {
     if (std::shared_ptr<Subpage> s = LocateSubpage(SubpageNumber))
+    {
+        _cursor = _subcodeIndex[SubpageNumber];
         _carouselPage = s;
+    }
     // no warning on failure
 }
 
@@ -416,7 +453,7 @@ std::shared_ptr<TTXLine> Subpage::GetRow(unsigned int row)
     
     if (_lines[row]==nullptr && row>0 && row<26)
     {
-        _lines[row].reset(new TTXLine()); // return a blank row for X/1-X/25
+        _lines[row] = RowStore::Instance()->Blank(); // return a blank row for X/1-X/25
     }
     return _lines[row];
 }
@@ -440,6 +477,8 @@ void Subpage::SetRow(unsigned int rownumber, std::shared_ptr<TTXLine> line)
         
         if (rownumber > _lastPacket)
             _lastPacket = rownumber;
+        
+        line = RowStore::Instance()->Intern(line); // share identical rows between subpages
     }
 
     if (_lines[rownumber]==nullptr)
@@ -484,6 +523,77 @@ void Subpage::DeleteRow(unsigned int rownumber, int designationCode)
     }
 }
 
+uint64_t Subpage::ContentHash()
+{
+    uint8_t settings[7] = {(uint8_t)(_subcode >> 8), (uint8_t)_subcode, (uint8_t)(_status >> 8), (uint8_t)_status, _cycleTime, _timedMode, _region};
+    uint64_t hash = FNV1a(settings, sizeof(settings));
+    
+    for (int i=0; i<=MAXROW; i++)
+    {
+        uint8_t row = i;
+        hash = FNV1a(&row, 1, hash); // so that moving a row changes the hash
+        for (std::shared_ptr<TTXLine> line = _lines[i]; line != nullptr; line = line->GetNextLine())
+        {
+            if (i > 0 && i < 26 && line->IsBlank())
+                continue; // a stored blank row is the same as no row
+            std::array<uint8_t, 40> content = line->GetLine();
+            hash = FNV1a(content.data(), content.size(), hash);
+        }
+    }
+    return hash;
+}
+
+// compare two rows including any chained enhancement lines
+static bool SameRow(std::shared_ptr<TTXLine> a, std::shared_ptr<TTXLine> b, bool blankIsMissing)
+{
+    if (blankIsMissing)
+    {
+        if (a && a->IsBlank())
+            a = nullptr;
+        if (b && b->IsBlank())
+            b = nullptr;
+    }
+    
+    while (a && b)
+    {
+        if (a != b && a->GetLine() != b->GetLine())
+            return false;
+        a = a->GetNextLine();
+        b = b->GetNextLine();
+    }
+    return a == b; // both at the end
+}
+
+int Subpage::ReuseRows(Subpage &subpage)
+{
+    int changed = 0;
+    bool textChanged = false;
+    
+    for (int i=0; i<=MAXROW; i++)
+    {
+        if (SameRow(_lines[i], subpage._lines[i], i > 0 && i < 26))
+        {
+            _lines[i] = subpage._lines[i];
+        }
+        else
+        {
+            changed++;
+            if (i < 26)
+                textChanged = true;
+        }
+    }
+    
+    if (!textChanged)
+    {
+        // the page CRC only covers the header and rows 1-25
+        _headerCRC = subpage._headerCRC;
+        _subpageCRC = subpage._subpageCRC;
+        _subpageChanged = subpage._subpageChanged;
+    }
+    
+    return changed;
+}
+
 void Subpage::SetFastext(std::array<FastextLink, 6> links)
 {
     std::array<uint8_t, 40> line; // 40 bytes of packet data in CODING_HAMMING_8_4 form
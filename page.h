@@ -7,8 +7,10 @@
 #include <memory>
 #include <fstream>
 #include <string>
-#include <list>
+#include <vector>
+#include <map>
 #include <array>
+#include <algorithm>
 
 #include <cstdint>
 #include <cstdlib>
@@ -85,6 +87,14 @@ class Subpage
         void SetSubpageCRC(uint16_t crc){_subpageCRC = crc;}; // update the stored crc
         uint16_t GetSubpageCRC(){return _subpageCRC;}; // retrieve the stored crc
         
+        uint64_t ContentHash(); // hash of the subcode, settings, and rows to spot subpages which haven't changed
+        
+        /** Share the rows of another version of this subpage which are unchanged so that they keep their cached encodings.
+         *  If none of rows 0-25 changed the CRCs are carried over too.
+         *  @return the number of rows which are different
+         */
+        int ReuseRows(Subpage &subpage);
+        
     private:
         uint16_t _subcode;
         uint16_t _status;
@@ -115,6 +125,7 @@ class Page
         void InsertSubpage(std::shared_ptr<Subpage> s);
         void RemoveSubpage(std::shared_ptr<Subpage> s);
         unsigned int GetSubpageCount() {return _subpages.size();};
+        std::vector<std::shared_ptr<Subpage>> GetSubpages() {return _subpages;};
         
         int GetPageNumber() const {return _pageNumber;};
         void SetPageNumber(int page);
@@ -128,11 +139,27 @@ class Page
         void SetPageFunctionInt(int pageFunction);
         void SetPageCodingInt(int pageCoding);
 
+        /** Repetition weight within the magazine cycle.
+         *  2 to 9 sends the page that many times per cycle, -2 to -9 sends it once every that many cycles.
+         */
+        int GetRepeat() {return _repeat;};
+        void SetRepeat(int repeat) {_repeat = repeat;};
+        
         bool Special() {return (_pageFunction == GPOP || _pageFunction == POP || _pageFunction == GDRCS || _pageFunction == DRCS || _pageFunction == MOT || _pageFunction == MIP);} // more convenient way to tell if a page is 'special'.
         
         void ClearPage();
         void RenumberSubpages();
         
+        /** Take the page number, coding, and subpages of another page, e.g. one freshly loaded from file */
+        void ReplaceContent(const Page &page){*this = page;};
+        
+        /** Swap in the subpages of another page which have the same subcode and content as ours,
+         *  so that they keep their CRCs and cached encodings and aren't flagged as changed.
+         *  Subpages which did change share the rows which didn't.
+         *  @return the number of our subpages which are new or different
+         */
+        int ReuseSubpages(Page &page);
+        
         bool IsCarousel();
 
         void StepFirstSubpage();
@@ -153,10 +180,15 @@ class Page
         PageCoding _pageCoding;
         PageFunction _pageFunction;
         bool _pageChanged; // page was reloaded
+        int _repeat; // transmissions per magazine cycle, or negative for cycles per transmission
         
-        std::list<std::shared_ptr<Subpage>> _subpages; // list of subpages
-        std::list<std::shared_ptr<Subpage>>::iterator _iter;
+        std::vector<std::shared_ptr<Subpage>> _subpages; // subpages in transmission order
+        std::size_t _cursor; // index of _carouselPage in _subpages
         std::shared_ptr<Subpage> _carouselPage;
+        
+        std::map<uint16_t, std::size_t> _subcodeIndex; // subcode to index lookup for LocateSubpage
+        bool _subcodeIndexValid; // index must be rebuilt after subpages are added, removed, or renumbered
+        void RebuildSubcodeIndex();
 };
 };
 #endif // PAGE_H
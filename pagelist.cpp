@@ -7,7 +7,10 @@ using namespace vbit;
 
 PageList::PageList(Configure *configure, Debug *debug) :
     _configure(configure),
-    _debug(debug)
+    _debug(debug),
+    _serviceAttached(false),
+    _fieldPending(false),
+    _pagesChanged(false)
 {
     for (int i=0;i<8;i++)
     {
@@ -59,6 +62,8 @@ void PageList::UpdatePageLists(std::shared_ptr<TTXPageStream> page, bool noupdat
 {
     int mag=(page->GetPageNumber() >> 8) & 0x7;
     
+    page->UpdateSubtitleFlag();
+    
     if (page->Special() && !page->GetOneShotFlag()) // OneShot pages can't be special
     {
         // Page is 'special'
@@ -208,6 +213,39 @@ bool PageList::Contains(std::shared_ptr<TTXPageStream> page)
     return false;
 }
 
+void PageList::RunAtFieldBoundary(std::function<void()> fn)
+{
+    if (!_serviceAttached)
+    {
+        fn(); // e.g. a dry run
+        return;
+    }
+    
+    std::unique_lock<std::mutex> lock(_fieldMtx);
+    _fieldDone.wait(lock, [this]{ return !_fieldPending; }); // one task at a time, as the file monitor and interface may both post one
+    _fieldTask = fn;
+    _fieldPending = true;
+    _fieldDone.wait(lock, [this]{ return !_fieldPending; });
+}
+
+void PageList::FieldBoundary()
+{
+    // This is called from the Service thread
+    if (!_fieldPending)
+        return;
+    
+    std::lock_guard<std::mutex> lock(_fieldMtx);
+    _fieldTask();
+    _fieldTask = nullptr;
+    
+    for (int i=0;i<8;i++)
+        _mag[i]->GetCarousel()->Purge(); // don't leave deleted pages and former carousels in the schedule until they come due
+    
+    _pagesChanged = true;
+    _fieldPending = false;
+    _fieldDone.notify_all();
+}
+
 int PageList::GetSize(int mag)
 {
     if (mag < 8 && mag >= 0)
@@ -7,6 +7,10 @@
 #include <errno.h>
 #include <vector>
 #include <list>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 
 #include "configure.h"
 #include "debug.h"
@@ -45,12 +49,39 @@ namespace vbit
             void CheckForPacket29OrCustomHeader(std::shared_ptr<TTXPageStream> page);
             
             int GetSize(int mag);
+            
+            /** @return a copy of the list of pages in a magazine */
+            std::list<std::shared_ptr<TTXPageStream>> GetPages(int mag){return _pageList[mag];};
+            
+            /** Run a function on the service thread at the start of the next field and wait for it to finish.
+             *  Lets FileMonitor apply a whole set of page changes at once, between two fields.
+             *  The function is run straight away if no service has attached to this page list.
+             *  Also used to take a consistent copy of the page lists from another thread.
+             */
+            void RunAtFieldBoundary(std::function<void()> fn);
+            
+            /** Called by the Service that transmits this page list */
+            void AttachService(){_serviceAttached = true;};
+            void FieldBoundary();
+            bool IsFieldTaskPending(){return _fieldPending;};
+            
+            /** Note that pages have been added, removed or edited, e.g. when an interface client closes a page */
+            void PagesChanged(){_pagesChanged = true;};
+            /** @return true if pages have changed since this was last called */
+            bool TakePagesChanged(){return _pagesChanged.exchange(false);};
 
         private:
             Configure* _configure; // The configuration object
             Debug* _debug;
             std::list<std::shared_ptr<TTXPageStream>> _pageList[8]; /// The list of Pages in this service. One list per magazine
             PacketMag* _mag[8];
+            
+            bool _serviceAttached;
+            std::mutex _fieldMtx;
+            std::condition_variable _fieldDone;
+            std::atomic<bool> _fieldPending; // _fieldTask is waiting to run
+            std::function<void()> _fieldTask;
+            std::atomic<bool> _pagesChanged;
     };
 }
 
@@ -0,0 +1,85 @@
+/** Real-time scheduling helpers
+ */
+#include "realtime.h"
+
+#ifdef WIN32
+#include <chrono>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <cstring>
+#include <cerrno>
+#include <time.h>
+#endif
+
+#define PREFAULT_STACK (256*1024) // bytes of stack to map in advance
+
+using namespace vbit;
+
+void vbit::SetThreadCPU(std::thread *thread, int cpu, Debug *debug, std::string name)
+{
+#ifdef WIN32
+    (void)thread;
+    (void)cpu;
+    debug->Log(Debug::LogLevels::logWARN,"[SetThreadCPU] cpu affinity is not supported on this platform");
+#else
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    pthread_t handle = thread ? thread->native_handle() : pthread_self();
+    if (pthread_setaffinity_np(handle, sizeof(cpu_set_t), &cpuset))
+        debug->Log(Debug::LogLevels::logERROR,"[SetThreadCPU] Unable to run " + name + " on cpu " + std::to_string(cpu));
+    else
+        debug->Log(Debug::LogLevels::logINFO,"[SetThreadCPU] Running " + name + " on cpu " + std::to_string(cpu));
+#endif
+}
+
+void vbit::SetThreadRealTime(std::thread *thread, int priority, Debug *debug, std::string name)
+{
+#ifdef WIN32
+    (void)thread;
+    (void)priority;
+    debug->Log(Debug::LogLevels::logWARN,"[SetThreadRealTime] real-time scheduling is not supported on this platform");
+#else
+    struct sched_param param;
+    param.sched_priority = priority;
+    pthread_t handle = thread ? thread->native_handle() : pthread_self();
+    int err = pthread_setschedparam(handle, SCHED_FIFO, &param);
+    if (err)
+        debug->Log(Debug::LogLevels::logERROR,"[SetThreadRealTime] Unable to give " + name + " real-time priority: " + strerror(err));
+    else
+        debug->Log(Debug::LogLevels::logINFO,"[SetThreadRealTime] Running " + name + " at SCHED_FIFO priority " + std::to_string(priority));
+#endif
+}
+
+void vbit::LockMemory(Debug *debug)
+{
+#ifdef WIN32
+    debug->Log(Debug::LogLevels::logWARN,"[LockMemory] memory locking is not supported on this platform");
+#else
+    if (mlockall(MCL_CURRENT | MCL_FUTURE))
+        debug->Log(Debug::LogLevels::logERROR,"[LockMemory] Unable to lock memory: " + std::string(strerror(errno)));
+    else
+        debug->Log(Debug::LogLevels::logINFO,"[LockMemory] Memory locked");
+#endif
+}
+
+void vbit::PrefaultStack()
+{
+    unsigned char stack[PREFAULT_STACK];
+    volatile unsigned char *p = stack; // volatile so the writes aren't optimised away
+    for (int i = 0; i < PREFAULT_STACK; i += 4096)
+        p[i] = 0; // one write per page is enough to map it
+}
+
+int64_t vbit::MonotonicNanoseconds()
+{
+#ifdef WIN32
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
@@ -0,0 +1,38 @@
+#ifndef _REALTIME_H_
+#define _REALTIME_H_
+
+#include <thread>
+#include <string>
+#include <cstdint>
+
+#include "debug.h"
+
+namespace vbit
+{
+    /* Options for keeping output timing deterministic on a busy machine.
+     * They are best effort. A failure is logged and vbit2 carries on with normal scheduling.
+     */
+    
+    /** Run a thread on one processor
+     *  @param thread The thread, or nullptr for the calling thread
+     *  @param name Used in log messages
+     */
+    void SetThreadCPU(std::thread *thread, int cpu, Debug *debug, std::string name);
+    
+    /** Run a thread under the SCHED_FIFO real-time policy. Usually needs root or CAP_SYS_NICE.
+     *  @param thread The thread, or nullptr for the calling thread
+     *  @param priority 1-99
+     */
+    void SetThreadRealTime(std::thread *thread, int priority, Debug *debug, std::string name);
+    
+    /** Lock the process's current and future memory into RAM so that it is never paged out */
+    void LockMemory(Debug *debug);
+    
+    /** Touch enough of the calling thread's stack that later calls don't page fault */
+    void PrefaultStack();
+    
+    /** @return nanoseconds on the monotonic clock, which isn't stepped when the system time changes */
+    int64_t MonotonicNanoseconds();
+}
+
+#endif
@@ -0,0 +1,70 @@
+#include "rowStore.h"
+
+using namespace vbit;
+
+RowStore::RowStore() :
+    _inserts(0),
+    _blank(new TTXLine())
+{
+    _rows.emplace(Hash(_blank->GetLine()), _blank);
+}
+
+uint64_t RowStore::Hash(const std::array<uint8_t, 40> &line)
+{
+    return FNV1a(line.data(), line.size());
+}
+
+std::shared_ptr<TTXLine> RowStore::Intern(std::shared_ptr<TTXLine> line)
+{
+    if (line == nullptr || line->GetNextLine() != nullptr)
+        return line; // chained lines are for enhancement packets and can't be shared
+
+    std::array<uint8_t, 40> content = line->GetLine();
+    uint64_t hash = Hash(content);
+
+    std::lock_guard<std::mutex> lock(_mtx);
+
+    auto range = _rows.equal_range(hash);
+    for (auto it = range.first; it != range.second;)
+    {
+        std::shared_ptr<TTXLine> stored = it->second.lock();
+        if (stored == nullptr)
+        {
+            it = _rows.erase(it); // expired
+        }
+        else if (stored == line || stored->GetLine() == content)
+        {
+            return stored;
+        }
+        else
+        {
+            ++it; // hash collision
+        }
+    }
+
+    _rows.emplace(hash, line);
+
+    // sweep out expired rows once the store has doubled since the last sweep
+    if (++_inserts > _rows.size() / 2)
+        _prune();
+
+    return line;
+}
+
+std::size_t RowStore::GetCount()
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    return _rows.size();
+}
+
+void RowStore::_prune()
+{
+    for (auto it = _rows.begin(); it != _rows.end();)
+    {
+        if (it->second.expired())
+            it = _rows.erase(it);
+        else
+            ++it;
+    }
+    _inserts = 0;
+}
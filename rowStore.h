@@ -0,0 +1,57 @@
+#ifndef _ROWSTORE_H_
+#define _ROWSTORE_H_
+
+#include <cstdint>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "ttxline.h"
+#include "hash.h"
+
+namespace vbit
+{
+    /** RowStore - a process wide store of teletext rows keyed on their content.
+     *  Subpages intern their rows 0-25 here so that identical rows in different subpages,
+     *  pages and services share a single TTXLine, and so are held and encoded only once.
+     *  The store only holds weak references. A row is freed when the last subpage using it lets go.
+     */
+    class RowStore
+    {
+        public:
+            static RowStore *Instance(){
+                static RowStore store;
+                return &store;
+            }
+
+            /**
+             * @param line A line which must not be changed after it is interned
+             * @return The stored line with the same content, or line itself if it is new
+             */
+            std::shared_ptr<TTXLine> Intern(std::shared_ptr<TTXLine> line);
+
+            /** @return A shared line of 40 spaces */
+            std::shared_ptr<TTXLine> Blank(){ return _blank; }
+
+            /** @return The number of distinct rows in the store, including any not yet pruned */
+            std::size_t GetCount();
+
+            /** FNV-1a 64 bit hash of a 40 byte row */
+            static uint64_t Hash(const std::array<uint8_t, 40> &line);
+
+        private:
+            RowStore();
+            RowStore(const RowStore&) = delete;
+            RowStore& operator=(const RowStore&) = delete;
+
+            void _prune(); // remove rows which are no longer used
+
+            std::mutex _mtx;
+            std::unordered_multimap<uint64_t, std::weak_ptr<TTXLine>> _rows;
+            std::size_t _inserts; // rows added since the last prune
+            std::shared_ptr<TTXLine> _blank;
+    };
+}
+
+#endif // _ROWSTORE_H_
@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+# Stand-in external field clock for testing vbit2 --fieldclock
+# Sends a field tick (or a PCR) every 20ms to a named pipe or UDP port.
+#
+# fieldclock.py /tmp/vbit2-clock          write F lines to a named pipe, creating it if needed
+# fieldclock.py udp:5580                  send F datagrams to localhost port 5580
+# fieldclock.py udp:5580 --pcr            send P <pcr> datagrams instead
+# fieldclock.py udp:5580 --ppm 500        run 500 parts per million fast to simulate a drifting clock
+# fieldclock.py udp:5580 --stop 10        stop ticking for 2 seconds after 10 seconds
+
+import argparse
+import os
+import socket
+import stat
+import time
+
+PCR_HZ = 27000000
+PCR_WRAP = (1 << 33) * 300
+
+parser = argparse.ArgumentParser(description="Stand-in external field clock for vbit2")
+parser.add_argument("target", help="named pipe path, or udp:<port> or udp:<host>:<port>")
+parser.add_argument("--pcr", action="store_true", help="send 27MHz PCR values instead of field pulses")
+parser.add_argument("--ppm", type=float, default=0, help="clock rate error in parts per million")
+parser.add_argument("--stop", type=float, default=0, help="pause ticking for 2 seconds after this many seconds")
+args = parser.parse_args()
+
+if args.target.startswith("udp:"):
+    parts = args.target[4:].split(":")
+    address = (parts[0], int(parts[1])) if len(parts) == 2 else ("127.0.0.1", int(parts[0]))
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    send = lambda line: sock.sendto(line.encode("ascii"), address)
+else:
+    if not os.path.exists(args.target):
+        os.mkfifo(args.target)
+    elif not stat.S_ISFIFO(os.stat(args.target).st_mode):
+        print(args.target + " is not a named pipe")
+        quit()
+    pipe = open(args.target, "w", buffering=1) # blocks until vbit2 opens the pipe
+    def send(line):
+        pipe.write(line)
+
+period = 0.02 / (1 + args.ppm / 1000000)
+start = time.monotonic()
+field = 0
+stopped = False
+
+try:
+    while True:
+        field += 1
+        deadline = start + field * period
+        delay = deadline - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+        
+        if args.stop and not stopped and field * 0.02 >= args.stop:
+            stopped = True
+            time.sleep(2)
+            continue # the ticks for the missing fields are never sent
+        
+        if args.pcr:
+            send("P " + str((field * PCR_HZ // 50) % PCR_WRAP) + "\n")
+        else:
+            send("F\n")
+except (KeyboardInterrupt, BrokenPipeError):
+    pass
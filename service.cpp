@@ -4,21 +4,74 @@
 
 using namespace vbit;
 
-Service::Service(Configure *configure, Debug *debug, PageList *pageList, PacketServer *packetServer, InterfaceServer *interfaceServer) :
+#define SLEW_GAIN 2000 // ppm of rate change for each field the master clock is out
+
+// transport stream writers by output path, so that services writing to the same output share one multiplex.
+// Services are all created on the main thread.
+static std::map<std::string, TSWriter*> TSOutputs;
+
+Service::Service(Configure *configure, Debug *debug, PageList *pageList, PacketServer *packetServer, InterfaceServer *interfaceServer, bool primary) :
     _configure(configure),
     _debug(debug),
     _pageList(pageList),
     _packetServer(packetServer),
     _interfaceServer(interfaceServer),
-    _fieldCounter(49) // roll over immediately
+    _primary(primary)
 {
+    // start in step with the system clock, as output is paced from here on rather than chasing it
+    int64_t fields = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 20 - 1; // the first line rolls over into the current field
+    _masterClock.seconds = fields / 50;
+    _masterClock.fields = fields % 50;
+    _fieldCounter = _masterClock.fields;
+    
+    _OutputFormat = _configure->GetOutputFormat();
+    bool ts = _OutputFormat == Configure::OutputFormat::TS || _OutputFormat == Configure::OutputFormat::TSNPTS;
+    _tsWriter = nullptr;
+    
+    if (ts && TSOutputs.count(_configure->GetOutputPath()))
+    {
+        // add this service's teletext to another service's transport stream
+        _tsWriter = TSOutputs[_configure->GetOutputPath()];
+        _output = _tsWriter->GetOutput();
+    }
+    else if (_configure->GetOutputPath().empty())
+    {
+        _output = &std::cout;
+    }
+    else
+    {
+        std::ofstream *file = new std::ofstream(_configure->GetOutputPath(), std::ios::out | std::ios::binary);
+        if (!file->is_open())
+        {
+            std::cerr << "unable to open output " << _configure->GetOutputPath() << "\n";
+            exit(EXIT_FAILURE);
+        }
+        _output = file;
+    }
+    
+    if (ts && !_tsWriter)
+    {
+        _tsWriter = new TSWriter(_output, _configure, _debug);
+        TSOutputs[_configure->GetOutputPath()] = _tsWriter;
+    }
+    if (_tsWriter)
+        _tsStream = _tsWriter->AddStream(_configure);
+    
     _magList=_pageList->GetMagazines();
+    _pageList->AttachService(); // page changes are now applied by this service between fields
     // Register all the magazine packet sources
     for (uint8_t mag=0;mag<8;mag++)
     {
         PacketMag* m=_magList[mag];
         m->SetPriority(_configure->GetMagazinePriority(mag)); // set the mags to the desired priorities
-        _register(&_magazineSources, m); // use the PacketMags created in pageList rather than duplicating them
+        _magSources[mag] = m; // use the PacketMags created in pageList rather than duplicating them
+        if (_configure->GetParallelMagazines())
+        {
+            MagazineProducer* producer = new MagazineProducer(m, _debug);
+            _producers.push_back(producer);
+            _magSources[mag] = producer;
+        }
+        _register(&_magazineSources, _magSources[mag]);
     }
     
     // register datacast sources
@@ -37,12 +90,25 @@ Service::Service(Configure *configure, Debug *debug, PageList *pageList, PacketS
     _datacastLines = _configure->GetDatacastLines();
     
     _lineCounter = _linesPerField - 1; // roll over immediately
+    _fieldLines.fill(0);
     
-    _OutputFormat = _configure->GetOutputFormat();
-    _PTS = 0;
-    _PTSFlag = true;
-    _PID = _configure->GetTSPID();
-    _tscontinuity = 0;
+    if (_configure->GetMagazineScheduling() == Configure::MagazineScheduling::WeightedScheduling)
+        _magScheduler = new WeightedScheduler(_magList, _magSources, _configure, _debug);
+    else
+        _magScheduler = new PriorityScheduler(&_magazineSources);
+    
+    // room for a frame of lines so the output buffers aren't reallocated while running
+    _FrameBuffer.reserve(_linesPerField * 2);
+    
+    _fieldClock = nullptr;
+    if (!_configure->GetFieldClock().empty())
+        _fieldClock = new FieldClock(_configure->GetFieldClock(), _debug);
+    _pacer = new FieldPacer(_linesPerField, _configure->GetOutputBurst(), _debug, _fieldClock);
+    
+    _lookahead = _configure->GetOutputLookahead();
+    _outputQueue = nullptr;
+    if (_lookahead)
+        _outputQueue = new SpscQueue<QueuedLine>((_lookahead + 1) * _linesPerField); // room for the look-ahead plus the field being generated
 }
 
 Service::~Service()
@@ -58,15 +124,43 @@ int Service::run()
 {
     _debug->Log(Debug::LogLevels::logDEBUG,"[Service::run] This is the worker process");
     
-    std::list<PacketSource*>::const_iterator magIterator=_magazineSources.begin(); // Iterator for magazine packet sources
     std::list<PacketSource*>::const_iterator dcIterator=_datacastSources.begin(); // Iterator for datacast sources
 
     Packet* pkt=new Packet(8,25);  // This just allocates storage.
 
-    static Packet* filler=new Packet(8,25);  // A pre-prepared quiet packet to avoid eating the heap
+    Packet* filler=new Packet(8,25);  // A pre-prepared quiet packet to avoid eating the heap
 
     _debug->Log(Debug::LogLevels::logINFO,"[Service::run] Lines per field: " + std::to_string((int)_linesPerField));
     _debug->Log(Debug::LogLevels::logINFO,"[Service::run] Dedicated datacast lines: " + std::to_string((int)_datacastLines));
+    
+    if (!_producers.empty())
+    {
+        // started first so that they keep normal scheduling on any cpu
+        _debug->Log(Debug::LogLevels::logINFO,"[Service::run] Building magazines in parallel");
+        for (std::vector<MagazineProducer*>::iterator it = _producers.begin(); it != _producers.end(); ++it)
+            (*it)->Start();
+    }
+    
+    // set up this thread before starting the output thread, which inherits the same cpu and priority
+    if (_configure->GetCPU() >= 0)
+        SetThreadCPU(nullptr, _configure->GetCPU(), _debug, "service");
+    if (_configure->GetRealTimePriority())
+        SetThreadRealTime(nullptr, _configure->GetRealTimePriority(), _debug, "service");
+    if (_configure->GetLockMemory())
+        PrefaultStack();
+    
+    if (_outputQueue)
+    {
+        _debug->Log(Debug::LogLevels::logINFO,"[Service::run] Output look-ahead: " + std::to_string(_lookahead) + " fields");
+        std::thread outputThread(&Service::_outputRun, this);
+        outputThread.detach();
+    }
+    
+    if (_fieldClock)
+        _fieldClock->Start();
+    
+    _pacer->Reset(); // time from when output actually starts
+    
     while(1)
     {
         // Send ONLY one packet per loop
@@ -77,18 +171,18 @@ int Service::run()
         {
             if (_packet830->GetPacket(pkt) != nullptr)
             {
-                _packetOutput(pkt);
+                _packetOutput(pkt, Debug::srcBSDP);
             }
             else
             {
-                _packetOutput(filler);
+                _fillerOutput(filler, Debug::fillBSDP);
             }
         }
         // Special case for debug. Ensures it can steal lines from other sources during DATABROADCAST event
         else if (_packetDebug->IsReady(_debug->GetDebugLevel() == Debug::LogLevels::logDEBUG)) // force if log level is DEBUG
         {
             _packetDebug->GetPacket(pkt);
-            _packetOutput(pkt);
+            _packetOutput(pkt, Debug::srcDEBUG);
         }
         else
         {
@@ -115,46 +209,21 @@ int Service::run()
                 }
                 if (p)
                 {
+                    // a forced channel with an empty buffer sends the datacast filler, the other sources are all channels
+                    bool idle = static_cast<PacketDatacast*>(p)->GetBufferOccupancy() == 0;
                     p->GetPacket(pkt);
-                    _packetOutput(pkt);
+                    if (idle)
+                        _fillerOutput(pkt, Debug::fillDATACAST);
+                    else
+                        _packetOutput(pkt, Debug::srcDATACAST);
                     continue; // main while loop
                 }
                 // else fall through to magazine sources
             }
             
             // now try magazine sources
-            uint8_t sourceCount=0;
-            uint8_t listSize=_magazineSources.size();
-            bool force=false;
-            do
-            {
-                // Loop back to the first source
-                if (magIterator==_magazineSources.end())
-                {
-                    magIterator=_magazineSources.begin();
-                }
-
-                // If we have tried all sources with and without force, then break out with a filler to prevent a deadlock
-                if (sourceCount>listSize*2)
-                {
-                    p=nullptr;
-                    // If we get a lot of this maybe there is a problem?
-                    break;
-                }
-
-                // If we have gone around once and got nothing, then force sources to go if possible.
-                if (sourceCount>listSize)
-                {
-                    force=true;
-                }
-
-                // Get the packet source
-                p=(*magIterator);
-                ++magIterator;
-
-                sourceCount++; // Count how many sources we tried.
-            }
-            while (!p->IsReady(force));
+            p=_magScheduler->NextSource();
+            Debug::LineUses reason = Debug::fillNOPACKET; // why a filler goes out if nothing else can
             
             // Did we find a packet?
             if (p)
@@ -162,11 +231,18 @@ int Service::run()
                 // GetPacket returns nullptr if the pkt isn't valid - if it's null go round again.
                 if (p->GetPacket(pkt) != nullptr)
                 {
-                    _packetOutput(pkt);
+                    int mag = 0;
+                    while (mag < 7 && _magSources[mag] != p)
+                        mag++;
+                    _packetOutput(pkt, Debug::srcMAGAZINE + mag);
                     continue; // main while loop
                 }
                 // else fall through to filler
             }
+            else
+            {
+                reason = _idleReason();
+            }
             
             if (!_datacastLines)
             {
@@ -192,13 +268,13 @@ int Service::run()
                 
                 if (p)
                 {
-                    _packetOutput(pkt);
+                    _packetOutput(pkt, Debug::srcDATACAST);
                     continue; // main while loop
                 }
                 // else fall through to filler
             }
             
-            _packetOutput(filler);
+            _fillerOutput(filler, reason);
         }
 
     } // while forever
@@ -207,23 +283,47 @@ int Service::run()
 
 void Service::_updateEvents()
 {
-    MasterClock *mc = mc->Instance();
-    MasterClock::timeStruct masterClock = mc->GetMasterClock();
+    MasterClock::timeStruct &masterClock = _masterClock;
     
     // Step the counters
     _lineCounter = (_lineCounter + 1) % _linesPerField;
     
-    auto t1 = std::chrono::system_clock::now();
-    auto duration = t1.time_since_epoch();
-    int64_t fields = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() / 20;
-    
-    time_t now = fields / 50;
-    
-    if (((int64_t)masterClock.seconds * 50 + masterClock.fields) > fields)
-        std::this_thread::sleep_for(std::chrono::milliseconds(40)); // back off for ≈2 fields to limit output to (less than) 50 fields per second
+    if (!_outputQueue)
+    {
+        // writing inline, so wait here until the line is due. With a look-ahead queue the output thread does this.
+        if (_pacer->BurstDue())
+            _flushOutput();
+        _pacer->Wait();
+    }
     
     if (_lineCounter == 0) // new field
     {
+        if (std::accumulate(_fieldLines.begin(), _fieldLines.end(), 0)) // nothing is sent before the first field
+        {
+            _debug->AddFieldLines(_fieldLines);
+            _fieldLines.fill(0);
+        }
+        
+        auto t1 = std::chrono::system_clock::now();
+        auto duration = t1.time_since_epoch();
+        int64_t fields = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() / 20;
+        
+        time_t now = fields / 50;
+        
+        if (_pageList->IsFieldTaskPending())
+        {
+            _pauseProducers();
+            _pageList->FieldBoundary(); // apply any waiting set of page changes
+            _resumeProducers();
+        }
+        
+        if (_tsWriter && _pageList->TakePagesChanged())
+        {
+            _pauseProducers(); // parallel magazines remove deleted pages from the lists
+            _updateTeletextPages();
+            _resumeProducers();
+        }
+        
         _fieldCounter = (_fieldCounter + 1) % 50;
         
         if (_fieldCounter == 0)
@@ -235,21 +335,55 @@ void Service::_updateEvents()
         
         _packetDebug->TimeAndField(masterClock, now, fields%50, false); // update the clocks in debugPacket.
         
+        bool resync = false;
         if (_fieldCounter == 0)
         {
-            // if internal master clock is behind real time, or more than 1 second ahead, resynchronise it.
-            if (masterClock.seconds < now || masterClock.seconds > now + 1)
+            if (_fieldClock)
+            {
+                // the master clock counts the external clock's fields, which needn't keep in step with this host's clock
+            }
+            else if (_configure->GetClockSlew())
+            {
+                // fields that the master clock is behind real time. With a look-ahead it is meant to be that far ahead.
+                int64_t behind = fields + _lookahead - ((int64_t)masterClock.seconds * 50 + masterClock.fields);
+                int64_t threshold = (int64_t)_configure->GetClockResyncThreshold() * 50;
+                resync = behind > threshold || behind < -threshold;
+                
+                // speed up or slow down output in proportion to the error, leaving it alone within a field
+                int ppm = 0;
+                if (!resync && (behind > 1 || behind < -1))
+                    ppm = std::max(-_configure->GetClockSlew(), std::min(_configure->GetClockSlew(), (int)behind * SLEW_GAIN));
+                
+                if (ppm != _debug->GetClockSlewRate())
+                    _debug->Log(Debug::LogLevels::logDEBUG,"[Service::_updateEvents] Master clock " + std::to_string(behind) + " fields behind, slewing " + std::to_string(ppm) + "ppm");
+                _debug->ClockSlew(ppm);
+                _pacer->SetRate(ppm);
+            }
+            else
+            {
+                // if internal master clock is behind real time, or more than 1 second ahead, resynchronise it.
+                resync = masterClock.seconds < now || masterClock.seconds > now + 1;
+            }
+            
+            if (resync)
             {
                 masterClock.seconds = now;
                 
                 _debug->Log(Debug::LogLevels::logWARN,"[Service::_updateEvents] Resynchronising master clock");
+                _debug->ClockResync();
                 
+                _pauseProducers();
                 for (int i=0;i<8;i++)
                     _magList[i]->InvalidateCycleTimestamp(); // reset magazine cycle duration calculations
+                _resumeProducers();
                 
                 _packetDebug->TimeAndField(masterClock, now, fields%50, true); // update the clocks in debugPacket.
             }
             
+            _magScheduler->NewSecond();
+            
+            _debug->CheckDump(); // SIGUSR1
+            
             if (masterClock.seconds%15==0) // TODO: how often do we want to trigger sending special packets?
             {
                 for (std::list<PacketSource*>::const_iterator iterator = _magazineSources.begin(), end = _magazineSources.end(); iterator != end; ++iterator)
@@ -260,7 +394,13 @@ void Service::_updateEvents()
             }
         }
         
-        mc->SetMasterClock(masterClock); // update the master clock singleton
+        if (_primary)
+        {
+            if (resync)
+                MasterClock::Instance()->StepMasterClock(masterClock); // invalidates times pages were last sent
+            else
+                MasterClock::Instance()->SetMasterClock(masterClock); // update the master clock singleton
+        }
         
         // New field, so set the FIELD event in all the registered magazine sources.
         for (std::list<PacketSource*>::const_iterator iterator = _magazineSources.begin(), end = _magazineSources.end(); iterator != end; ++iterator)
@@ -323,167 +463,171 @@ void Service::_updateEvents()
     }
 }
 
-void Service::_packetOutput(Packet* pkt)
+void Service::_pauseProducers()
+{
+    for (std::vector<MagazineProducer*>::iterator it = _producers.begin(); it != _producers.end(); ++it)
+        (*it)->Pause();
+}
+
+void Service::_resumeProducers()
 {
-    std::array<uint8_t, PACKETSIZE> *p = pkt->tx();
+    for (std::vector<MagazineProducer*>::iterator it = _producers.begin(); it != _producers.end(); ++it)
+        (*it)->Resume();
+}
+
+void Service::_packetOutput(Packet* pkt, int source)
+{
+    StageTimer timer(_debug->GetHistogram(Debug::stageOUTPUT));
     
-    switch (_OutputFormat)
+    _debug->CountPacket(source);
+    if (source < Debug::srcBSDP)
+        _fieldLines[Debug::lineMAGAZINE]++;
+    else if (source == Debug::srcBSDP)
+        _fieldLines[Debug::lineBSDP]++;
+    else if (source == Debug::srcDEBUG)
+        _fieldLines[Debug::lineDEBUG]++;
+    else if (source == Debug::srcDATACAST)
+        _fieldLines[Debug::lineDATACAST]++;
+    // filler lines are counted by _fillerOutput with their reason
+    
+    std::array<uint8_t, PACKETSIZE> *p;
+    if (pkt->IsTxReady())
     {
-        case Configure::OutputFormat::None:
-        {
-            /* disable stdout */
-            break;
-        }
+        p = pkt->tx(); // a magazine producer has already encoded it, and timed that
+    }
+    else
+    {
+        StageTimer txTimer(_debug->GetHistogram(Debug::stageTX));
+        p = pkt->tx();
+    }
+    
+    if (_outputQueue)
+    {
+        QueuedLine queued;
+        queued.packet = *p;
+        queued.clock = (int64_t)_masterClock.seconds * 50 + _masterClock.fields;
+        queued.line = _lineCounter;
         
-        case Configure::OutputFormat::T42:
+        while (_outputQueue->Size() >= (std::size_t)_lookahead * _linesPerField)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1)); // far enough ahead, wait for the output thread to catch up
+        _outputQueue->Push(queued);
+    }
+    else
+    {
+        _writeLine(p, (int64_t)_masterClock.seconds * 50 + _masterClock.fields, _lineCounter);
+    }
+}
+
+void Service::_fillerOutput(Packet* pkt, Debug::LineUses reason)
+{
+    _fieldLines[reason]++;
+    _packetOutput(pkt, Debug::srcFILLER);
+}
+
+Debug::LineUses Service::_idleReason()
+{
+    bool pages = false;
+    bool cycle = false;
+    for (int i=0; i<8; i++)
+    {
+        if (_pageList->GetSize(i) < 1)
+            continue;
+        pages = true;
+        if (_magList[i]->IsWaitingForField())
+            return Debug::fillERASURE;
+        if (_magList[i]->IsWaitingForSecond())
+            cycle = true;
+    }
+    
+    if (!pages)
+        return Debug::fillNOPAGES;
+    return cycle ? Debug::fillCYCLE : Debug::fillNOTREADY;
+}
+
+void Service::_outputRun()
+{
+    QueuedLine queued;
+    
+    while (true)
+    {
+        if (!_outputQueue->Pop(&queued))
         {
-            /* t42 output */
-            if (_configure->GetReverseFlag())
-            {
-                static std::array<uint8_t, PACKETSIZE> tmp;
-                for (unsigned int i=0;i<(p->size());i++)
-                {
-                    tmp[i]=ReverseByteTab[p->at(i)];
-                }
-                p = &tmp;
-            }
-            
-            std::cout.write((char*)p->data()+3, 42); // have to cast the pointer to char for cout.write()
-            
-            break;
+            // generation has fallen behind, wait for it
+            _debug->OutputUnderrun();
+            _debug->Log(Debug::LogLevels::logDEBUG,"[Service::_outputRun] Output queue underrun");
+            _flushOutput();
+            while (!_outputQueue->Pop(&queued))
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            _pacer->Reset(); // start timing afresh rather than bursting out the lines we missed
         }
         
-        case Configure::OutputFormat::Raw:
-        {
-            /* full 45 byte teletext packets */
-            std::cout.write((char*)p->data(), 45); // have to cast the pointer to char for cout.write()
-            
-            break;
-        }
+        if (queued.line == 0)
+            _debug->SetOutputQueue(_outputQueue->Size());
+        
+        if (_pacer->BurstDue())
+            _flushOutput();
+        _pacer->Wait();
         
-        case Configure::OutputFormat::TSNPTS:
-            _PTSFlag = false; // Don't generate PCR and PTS in output stream
-            /* fallthrough */
-            [[gnu::fallthrough]];
-        case Configure::OutputFormat::TS:
+        _writeLine(&queued.packet, queued.clock, queued.line);
+    }
+}
+
+void Service::_flushOutput()
+{
+    if (_tsWriter)
+        _tsWriter->Flush(); // may be shared with other services
+    else
+        _output->flush();
+}
+
+void Service::_writeLine(std::array<uint8_t, PACKETSIZE> *p, int64_t clock, uint16_t line)
+{
+    uint8_t field = clock % 50;
+    
+    {
+        StageTimer timer(_debug->GetHistogram(Debug::stageWRITE));
+            
+        switch (_OutputFormat)
         {
-            /* MPEG-2 transport stream holding a DVB-TXT Packetized Elementary Stream */
+            case Configure::OutputFormat::None:
+            {
+                /* disable stdout */
+                break;
+            }
             
-            if (_lineCounter == 0 && !(_fieldCounter&1))
+            case Configure::OutputFormat::T42:
             {
-                // a new frame has started - transmit data for previous frame if there is any
-                if (!(_PESBuffer.empty()))
+                /* t42 output */
+                std::array<uint8_t, PACKETSIZE> tmp;
+                if (_configure->GetReverseFlag())
                 {
-                    std::array<uint8_t, 46> padding;
-                    padding.fill(0xff);
-                    
-                    std::array<uint8_t, 188> ts;
-                    ts.fill(0xff);
-                    
-                    ts[0] = 0x47;
-                    ts[1] = (uint8_t)(_PID >> 8);
-                    ts[2] = (uint8_t)(_PID & 0xFF);
-                    
-                    if (_PTSFlag){
-                        ts[3] = 0x20 | _tscontinuity; // adaption field no payload
-                        ts[4] = 0x07; // 7 bytes in adaption field
-                        ts[5] = 0x10; // PCR flag
-                        // make PCR from our PTS
-                        ts[6] = _PTS >> 25;
-                        ts[7] = (_PTS >> 17) & 0xFF;
-                        ts[8] = (_PTS >> 9) & 0xFF;
-                        ts[9] = (_PTS >> 1) & 0xFF;
-                        ts[10] = (_PTS & 1) << 7;
-                        ts[11] = 0x00;
-                        std::cout.write((char*)ts.data(), 188); // write out transport stream packet
-                    }
-                    
-                    std::vector<uint8_t> header = {0x00, 0x00, 0x01, 0xBD}; // PES start code
-                    
-                    int numBlocks = _PESBuffer.size() + 1; // header and N lines
-                    int numTSPackets = ((numBlocks * 46) + 183) / 184; // round up
-                    int packetLength = (numTSPackets * 184) - 6;
-                    
-                    header.push_back(packetLength >> 8);
-                    header.push_back(packetLength & 0xff);
-                    
-                    /* bits | 7 | 6 |  5   | 4   |     3    |     2     |     1     |     0    |
-                            | 1 | 0 | Scrambling | Priority | Alignment | Copyright | Original | */
-                    header.push_back(0x85); // Align, Original
-                    
-                    /* bits |  7 | 6  |   5  |    4    |     3     |     2     |    1    |       0       |
-                            | PTS DTS | ESCR | ES rate | DSM trick | copy info | PES CRC | PES extension |*/
-                    header.push_back(_PTSFlag?0x80:0x00); // if _PTSFlag, PTS no DTS follows
-                    
-                    header.push_back(0x24); // PES header data length
-                    
-                    if (_PTSFlag)
+                    for (unsigned int i=0;i<(p->size());i++)
                     {
-                        // append PTS
-                        header.push_back(0x21 | ((_PTS & 0x1C0000000) >> 29));
-                        header.push_back((_PTS & 0x3FC00000) >> 22);
-                        header.push_back(0x01 | ((_PTS & 0x3F8000) >> 14));
-                        header.push_back((_PTS & 0x7F80) >> 7);
-                        header.push_back(0x01 | ((_PTS & 0x7F) << 1));
-                        
-                        _PTS += 3600;
-                        if (_PTS >= 0x200000000)
-                            _PTS = 0;
+                        tmp[i]=ReverseByteTab[p->at(i)];
                     }
-                    
-                    header.resize(0x2D, 0xff); // make PES header up to 45 bytes long with stuffing bytes.
-                    
-                    header.push_back(0x10); // append PES data identifier (EBU data)
-                    
-                    ts[1] = (uint8_t)((_PID >> 8) | 0x40);
-                    
-                    _tscontinuity = (_tscontinuity+1)&0xf;
-                    ts[3] = 0x10 | _tscontinuity; // no adaption field payload only
-                    
-                    std::cout.write((char*)ts.data(), 4); // transport stream header
-                    
-                    std::cout.write((char*)header.data(), header.size()); // output PES header and data_identifier
-                    
-                    for (unsigned int i = 0; i < _PESBuffer.size(); i++)
-                    {
-                        if (((i % 184) % 4) == 3) // new ts packet
-                        {
-                            ts[1] = (uint8_t)(_PID >> 8);
-                            _tscontinuity = (_tscontinuity+1)&0xf;
-                            ts[3] = 0x10 | _tscontinuity;
-                            std::cout.write((char*)ts.data(), 4); // transport stream header
-                        }
-                        std::cout.write((char*)_PESBuffer[i].data(), 46);
-                    }
-                    
-                    for (int i = numBlocks; i < numTSPackets * 4; i++)
-                    {
-                        std::cout.write((char*)padding.data(), 46); // pad out remainder of PES packet
-                    }
-                    
-                    _PESBuffer.clear(); // empty buffer ready for next field's packets
+                    p = &tmp;
                 }
+                
+                _output->write((char*)p->data()+3, 42); // have to cast the pointer to char for write()
+                
+                break;
             }
             
-            std::vector<uint8_t> data = {0x02, 0x2c}; // data_unit_id and data_unit_length (EBU teletext non-subtitle, 44 bytes)
-            
-            if (_lineCounter > 15)
+            case Configure::OutputFormat::Raw:
             {
-                data.push_back(((_fieldCounter&1)^1) << 5); //field parity, line number undefined
-            }
-            else
-            {
-                data.push_back((((_fieldCounter&1)^1) << 5) | (_lineCounter + 7)); // field parity and line number
+                /* full 45 byte teletext packets */
+                _output->write((char*)p->data(), 45); // have to cast the pointer to char for write()
+                
+                break;
             }
             
-            for (int i = 2; i < 45; i++)
+            case Configure::OutputFormat::TS:
+            case Configure::OutputFormat::TSNPTS:
             {
-                data.push_back(ReverseByteTab[p->at(i)]); // bits are reversed in PES stream
+                /* MPEG-2 transport stream holding a DVB-TXT Packetized Elementary Stream */
+                _tsWriter->WriteLine(_tsStream, p, clock, line);
+                break;
             }
-            
-            _PESBuffer.push_back(data);
-            
-            break;
         }
     }
     
@@ -491,17 +635,18 @@ void Service::_packetOutput(Packet* pkt)
     {
         // packet server needs feeding
         
-        if (_lineCounter == 0 && !(_fieldCounter&1))
+        if (line == 0 && !(field&1))
         {
             // a new field has started 
             
+            StageTimer timer(_debug->GetHistogram(Debug::stageSENDFIELD));
             _packetServer->SendField(_FrameBuffer);
             
             _FrameBuffer.clear(); // empty buffer ready for next frame's packets
         }
         
         /* internal format only: 45 bytes in the form field count, line high byte, line low byte, 42 payload bytes */
-        std::vector<uint8_t> data = {_fieldCounter, (uint8_t)(_lineCounter >> 8), (uint8_t)(_lineCounter & 0xFF)};
+        std::vector<uint8_t> data = {field, (uint8_t)(line >> 8), (uint8_t)(line & 0xFF)};
         
         for (int i = 3; i < 45; i++)
         {
@@ -511,3 +656,21 @@ void Service::_packetOutput(Packet* pkt)
         _FrameBuffer.push_back(data);
     }
 }
+
+void Service::_updateTeletextPages()
+{
+    std::vector<TSWriter::TeletextPage> pages;
+    pages.push_back({0x01, _configure->GetInitialMag(), _configure->GetInitialPage()}); // initial page
+    
+    for (int mag=0; mag<8; mag++)
+    {
+        std::list<std::shared_ptr<TTXPageStream>> list = _pageList->GetPages(mag);
+        for (std::list<std::shared_ptr<TTXPageStream>>::iterator it = list.begin(); it != list.end(); ++it)
+        {
+            if ((*it)->IsSubtitle()) // the subpages may be being edited, so use the flag kept by whoever holds the page
+                pages.push_back({0x02, (uint8_t)((*it)->GetPageNumber() >> 8), (uint8_t)((*it)->GetPageNumber() & 0xFF)}); // subtitle page
+        }
+    }
+    
+    _tsWriter->SetTeletextPages(_tsStream, pages);
+}
@@ -6,6 +6,10 @@
 #include <thread>
 #include <ctime>
 #include <list>
+#include <fstream>
+#include <map>
+#include <array>
+#include <numeric>
 
 #include "configure.h"
 #include "debug.h"
@@ -17,7 +21,13 @@
 #include "packetmag.h"
 #include "packet830.h"
 #include "packetDebug.h"
+#include "magazineScheduler.h"
+#include "magazineProducer.h"
 #include "masterClock.h"
+#include "spscQueue.h"
+#include "realtime.h"
+#include "fieldPacer.h"
+#include "tsWriter.h"
 
 namespace vbit
 {
@@ -35,8 +45,9 @@ namespace vbit
             /**
              * @param configure A Configure object with all the settings
              * @param pageList A pageList object already loaded with pages
+             * @param primary true for the service which keeps the shared master clock in step
              */
-            Service(Configure* configure, Debug* debug, PageList* pageList, PacketServer* packetServer, InterfaceServer *interfaceServer);
+            Service(Configure* configure, Debug* debug, PageList* pageList, PacketServer* packetServer, InterfaceServer *interfaceServer, bool primary=true);
             
             ~Service();
             
@@ -61,11 +72,16 @@ namespace vbit
             uint16_t _lineCounter; // Which VBI line are we on? Used to signal a new field.
             uint8_t _fieldCounter; // Which field? Used to time packet 8/30
             
-            uint64_t _PTS; // presentation timestamp counter
-            bool _PTSFlag; // generate PCR and PTS
+            MasterClock::timeStruct _masterClock; // this service's clock, used to pace output
+            bool _primary; // publish _masterClock to the MasterClock singleton
+            
+            std::ostream* _output; // where the output stream is written
             
             std::list<PacketSource*> _magazineSources; // A list of packet sources for magazine data
             std::list<PacketSource*> _datacastSources; // A list of sources for independent data line packets
+            MagazineScheduler* _magScheduler; // Policy choosing which magazine sends the next packet
+            PacketSource* _magSources[8]; // the source transmitting each magazine
+            std::vector<MagazineProducer*> _producers; // magazines built on their own threads, if enabled
 
             Packet830* _packet830; // BSDP packet source
             PacketDebug* _packetDebug; // Debug packet source
@@ -79,15 +95,49 @@ namespace vbit
              */
             void _updateEvents();
             
-            /* output a packet in the desired format */
-            void _packetOutput(Packet* pkt);
+            /* stop and restart the magazine threads around changes made from the service thread */
+            void _pauseProducers();
+            void _resumeProducers();
+            
+            /* output a packet in the desired format, or queue it for the output thread
+               source is the Debug::PacketSources entry it came from */
+            void _packetOutput(Packet* pkt, int source);
+            
+            /* output a filler line, counting why nothing else could be sent */
+            void _fillerOutput(Packet* pkt, Debug::LineUses reason);
+            
+            /* why no magazine was ready to send */
+            Debug::LineUses _idleReason();
+            
+            std::array<uint16_t, Debug::lineCOUNT> _fieldLines; // uses of the lines in the current field
             
-            /* queue up packets for outputting as a Packetised Elementary Stream */
-            std::vector<std::vector<uint8_t>> _PESBuffer;
+            void _flushOutput();
+            
+            /* write a line of the stream, timed by the master clock field and line it was generated for */
+            void _writeLine(std::array<uint8_t, PACKETSIZE> *p, int64_t clock, uint16_t line);
+            
+            /* output thread: drain the look-ahead queue one field every 20ms */
+            void _outputRun();
+            
+            /* a line generated ahead of output */
+            struct QueuedLine
+            {
+                std::array<uint8_t, PACKETSIZE> packet;
+                int64_t clock; // master clock fields since the epoch
+                uint16_t line;
+            };
+            
+            int _lookahead; // fields generated ahead of output, 0 to write inline
+            FieldPacer* _pacer; // times the lines written to the output
+            FieldClock* _fieldClock; // external clock the pacer follows, if any
+            SpscQueue<QueuedLine>* _outputQueue;
             
             Configure::OutputFormat _OutputFormat;
-            uint16_t _PID;
-            uint8_t _tscontinuity;
+            TSWriter* _tsWriter; // transport stream output, if selected
+            TSWriter::Stream* _tsStream; // this service's teletext in the transport stream
+            
+            /* list the initial page and any subtitle pages in the transport stream's PMT */
+            void _updateTeletextPages();
             
             /* queue up a frame of packets for the packet server */
             std::vector<std::vector<uint8_t>> _FrameBuffer;
@@ -0,0 +1,74 @@
+#ifndef _SPSCQUEUE_H_
+#define _SPSCQUEUE_H_
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+namespace vbit
+{
+    /** Lock free bounded queue for exactly one producer thread and one consumer thread.
+     *  Used to pass pre-generated lines between threads without blocking either of them.
+     */
+    template <typename T>
+    class SpscQueue
+    {
+        public:
+            /** @param capacity The most items the queue can hold. Rounded up to a power of two. */
+            explicit SpscQueue(std::size_t capacity) :
+                _head(0),
+                _tail(0)
+            {
+                std::size_t size = 1;
+                while (size < capacity)
+                    size <<= 1;
+                _buffer.resize(size);
+                _mask = size - 1;
+            }
+
+            /** Producer only
+             *  @return false if the queue is full
+             */
+            bool Push(const T &item)
+            {
+                std::size_t tail = _tail.load(std::memory_order_relaxed);
+                if (tail - _head.load(std::memory_order_acquire) > _mask)
+                    return false;
+                _buffer[tail & _mask] = item;
+                _tail.store(tail + 1, std::memory_order_release);
+                return true;
+            }
+
+            /** Consumer only
+             *  @return false if the queue is empty
+             */
+            bool Pop(T *item)
+            {
+                std::size_t head = _head.load(std::memory_order_relaxed);
+                if (head == _tail.load(std::memory_order_acquire))
+                    return false;
+                *item = _buffer[head & _mask];
+                _head.store(head + 1, std::memory_order_release);
+                return true;
+            }
+
+            /** @return The number of items queued. Only a snapshot when called from a third thread. */
+            std::size_t Size() const
+            {
+                return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+            }
+
+            std::size_t Capacity() const { return _mask + 1; }
+
+        private:
+            std::vector<T> _buffer;
+            std::size_t _mask;
+
+            // keep the indexes on separate cache lines so the two threads don't contend
+            std::atomic<std::size_t> _head; // next item to pop
+            char _pad[64];
+            std::atomic<std::size_t> _tail; // next free slot
+    };
+}
+
+#endif // _SPSCQUEUE_H_
@@ -0,0 +1,381 @@
+/** TSWriter
+ */
+#include "tsWriter.h"
+
+using namespace vbit;
+
+#define TS_PACKET 188
+#define TS_PAYLOAD 184
+#define TS_NULL_PID 0x1FFF
+#define TS_ID 1 // transport_stream_id
+#define TS_PROGRAM 1 // program_number
+#define TS_PSI_FRAMES 2 // send PAT and PMT every 80ms, within the 100ms DVB recommends
+#define TS_PTS_DELAY 3600 // present each PES a frame after the PCR that precedes it
+#define TS_PTS_MASK 0x1FFFFFFFFLL // 33 bits
+#define TS_FIELD_TICKS 1800 // 90kHz ticks per field
+#define TS_DESCRIPTOR_PAGES 51 // entries that fit in a descriptor
+#define TS_SECTION_MAX 1024 // longest PSI section
+
+// CRC_32 from ISO/IEC 13818-1 annex A
+static uint32_t SectionCRC(const uint8_t *data, std::size_t length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (std::size_t i = 0; i < length; i++)
+    {
+        crc ^= (uint32_t)data[i] << 24;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+    }
+    return crc;
+}
+
+// fill in section_length and append the CRC
+static void FinishSection(std::vector<uint8_t> *section)
+{
+    int length = section->size() - 3 + 4; // after the length field, including CRC
+    (*section)[1] = 0xB0 | (length >> 8);
+    (*section)[2] = length & 0xFF;
+    uint32_t crc = SectionCRC(section->data(), section->size());
+    section->push_back(crc >> 24);
+    section->push_back((crc >> 16) & 0xFF);
+    section->push_back((crc >> 8) & 0xFF);
+    section->push_back(crc & 0xFF);
+}
+
+struct TSWriter::Stream
+{
+    uint16_t pid;
+    std::string language; // ISO 639
+    std::vector<TeletextPage> pages;
+    bool primary; // the first stream, which carries the PCR and the tables
+    
+    // owned by the thread writing the stream
+    uint8_t continuity;
+    int64_t lastClock; // master clock at the last frame, to flag discontinuities
+    std::vector<std::array<uint8_t, 46>> lines; // queue up packets for outputting as a Packetised Elementary Stream
+    std::vector<uint8_t> packets; // transport stream packets for the frame being written
+};
+
+static void StartPacket(std::vector<uint8_t> *out, uint16_t pid, bool start, uint8_t adaptation, uint8_t continuity)
+{
+    out->push_back(0x47);
+    out->push_back((start ? 0x40 : 0x00) | (pid >> 8));
+    out->push_back(pid & 0xFF);
+    out->push_back(adaptation | continuity);
+}
+
+TSWriter::TSWriter(std::ostream *output, Configure *configure, Debug *debug) :
+    _output(output),
+    _debug(debug),
+    _PMTPID(configure->GetPMTPID()),
+    _timing(configure->GetOutputFormat() == Configure::OutputFormat::TS), // tsnpts has no PCR and PTS
+    _rate(configure->GetTSRate()),
+    _pcrClock(-1),
+    _patContinuity(0),
+    _pmtContinuity(0),
+    _pmtVersion(0),
+    _pmtChanged(false),
+    _psiCountdown(0),
+    _packetsWritten(0),
+    _rateCredit(0),
+    _overRate(false)
+{
+    _PAT = {
+        0x00, 0, 0, // table_id, section_length
+        TS_ID >> 8, TS_ID & 0xFF,
+        0xC1, // version 0, current
+        0x00, 0x00, // section_number, last_section_number
+        TS_PROGRAM >> 8, TS_PROGRAM & 0xFF,
+        (uint8_t)(0xE0 | (_PMTPID >> 8)), (uint8_t)(_PMTPID & 0xFF)
+    };
+    FinishSection(&_PAT);
+
+    _psi.reserve(TS_PACKET * 16);
+}
+
+TSWriter::Stream* TSWriter::AddStream(Configure *configure)
+{
+    Stream *s = new Stream();
+    s->pid = configure->GetTSPID();
+    s->language = configure->GetLanguage();
+    s->pages.push_back({0x01, configure->GetInitialMag(), configure->GetInitialPage()}); // until the pages are loaded just list the initial page
+    s->continuity = 0;
+    s->lastClock = -1;
+
+    // room for a frame of lines so the buffers aren't reallocated while running
+    s->lines.reserve(configure->GetLinesPerField() * 2);
+    s->packets.reserve(TS_PACKET * 64);
+
+    std::lock_guard<std::mutex> lock(_mtx);
+    for (std::vector<Stream*>::iterator it = _streams.begin(); it != _streams.end(); ++it)
+    {
+        if ((*it)->pid == s->pid)
+        {
+            std::cerr << "services sharing a transport stream need different PIDs\n";
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (s->pid == _PMTPID)
+    {
+        std::cerr << "PMT PID must differ from teletext PID\n";
+        exit(EXIT_FAILURE);
+    }
+
+    s->primary = _streams.empty();
+    _streams.push_back(s);
+    _buildPMT();
+    _pmtChanged = true;
+    return s;
+}
+
+void TSWriter::SetTeletextPages(Stream *s, const std::vector<TeletextPage> &pages)
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (pages.size() == s->pages.size() && std::equal(pages.begin(), pages.end(), s->pages.begin(),
+        [](const TeletextPage &a, const TeletextPage &b){ return a.type == b.type && a.magazine == b.magazine && a.page == b.page; }))
+        return; // nothing to change
+
+    s->pages = pages;
+    _buildPMT();
+    _pmtChanged = true;
+}
+
+void TSWriter::_buildPMT()
+{
+    uint16_t pcrPID = _timing ? _streams.front()->pid : TS_NULL_PID; // the first stream carries the PCR, if any
+
+    // share the longest section between the streams
+    std::size_t maxPages = (TS_SECTION_MAX - 16 - 7 * _streams.size()) / (5 * _streams.size());
+    maxPages = std::min(maxPages, (std::size_t)TS_DESCRIPTOR_PAGES);
+
+    _pmtVersion = (_pmtVersion + 1) & 0x1f;
+
+    _PMT = {
+        0x02, 0, 0, // table_id, section_length
+        TS_PROGRAM >> 8, TS_PROGRAM & 0xFF,
+        (uint8_t)(0xC1 | (_pmtVersion << 1)), // version, current
+        0x00, 0x00, // section_number, last_section_number
+        (uint8_t)(0xE0 | (pcrPID >> 8)), (uint8_t)(pcrPID & 0xFF),
+        0xF0, 0x00 // no program descriptors
+    };
+
+    for (std::vector<Stream*>::iterator s = _streams.begin(); s != _streams.end(); ++s)
+    {
+        std::size_t pages = (*s)->pages.size();
+        if (pages > maxPages)
+        {
+            _debug->Log(Debug::LogLevels::logWARN,"[TSWriter::_buildPMT] Too many pages for the teletext descriptor on PID " + std::to_string((*s)->pid) + ", only listing " + std::to_string(maxPages));
+            pages = maxPages;
+        }
+
+        _PMT.push_back(0x06); // stream_type PES private data
+        _PMT.push_back(0xE0 | ((*s)->pid >> 8));
+        _PMT.push_back((*s)->pid & 0xFF);
+        _PMT.push_back(0xF0); // ES_info_length
+        _PMT.push_back(2 + pages * 5);
+        _PMT.push_back(0x56); // teletext_descriptor
+        _PMT.push_back(pages * 5);
+
+        for (std::size_t i = 0; i < pages; i++)
+        {
+            TeletextPage &page = (*s)->pages[i];
+            _PMT.insert(_PMT.end(), (*s)->language.begin(), (*s)->language.end());
+            _PMT.push_back((page.type << 3) | (page.magazine & 7));
+            _PMT.push_back(page.page);
+        }
+    }
+
+    FinishSection(&_PMT);
+}
+
+void TSWriter::_writeSection(std::vector<uint8_t> *out, uint16_t pid, uint8_t *continuity, const std::vector<uint8_t> &section)
+{
+    std::size_t offset = 0;
+    while (offset < section.size())
+    {
+        std::size_t room = TS_PAYLOAD;
+        StartPacket(out, pid, offset == 0, 0x10, *continuity); // payload only
+        *continuity = (*continuity + 1) & 0xf;
+        if (offset == 0)
+        {
+            out->push_back(0x00); // pointer_field
+            room--;
+        }
+
+        std::size_t n = std::min(room, section.size() - offset);
+        out->insert(out->end(), section.begin() + offset, section.begin() + offset + n);
+        out->resize(out->size() + room - n, 0xff); // stuffing
+        offset += n;
+    }
+}
+
+void TSWriter::WriteLine(Stream *s, std::array<uint8_t, PACKETSIZE> *p, int64_t clock, uint16_t line)
+{
+    uint8_t field = clock % 50;
+
+    if (line == 0 && !(field&1))
+    {
+        // a new frame has started - transmit data for previous frame if there is any
+        if (!(s->lines.empty()))
+            _writeFrame(s, clock);
+    }
+
+    std::array<uint8_t, 46> data;
+    data[0] = 0x02; // data_unit_id (EBU teletext non-subtitle)
+    data[1] = 0x2c; // data_unit_length (44 bytes)
+
+    if (line > 15)
+    {
+        data[2] = ((field&1)^1) << 5; //field parity, line number undefined
+    }
+    else
+    {
+        data[2] = (((field&1)^1) << 5) | (line + 7); // field parity and line number
+    }
+
+    for (int i = 2; i < 45; i++)
+    {
+        data[i+1] = ReverseByteTab[p->at(i)]; // bits are reversed in PES stream
+    }
+
+    s->lines.push_back(data);
+}
+
+void TSWriter::_writeFrame(Stream *s, int64_t clock)
+{
+    bool primary = s->primary;
+    std::vector<uint8_t> &out = s->packets;
+    out.clear();
+
+    // other services' clocks slew and resync on their own, so their frames are presented relative to the first stream's latest PCR
+    int64_t timing = clock;
+    if (primary)
+        _pcrClock = clock;
+    else if (_pcrClock >= 0)
+        timing = _pcrClock;
+    
+    uint64_t pcr = (timing * TS_FIELD_TICKS) & TS_PTS_MASK; // PCR base, in step with the master clock
+    uint64_t pts = (pcr + TS_PTS_DELAY) & TS_PTS_MASK;
+
+    if (_timing && primary)
+    {
+        // adaptation field only, so the continuity counter doesn't step
+        StartPacket(&out, s->pid, false, 0x20, s->continuity);
+        out.push_back(0xB7); // adaptation field fills the packet
+        // flag a discontinuity if the master clock has stepped since the last PCR
+        out.push_back((s->lastClock >= 0 && clock != s->lastClock + 2) ? 0x90 : 0x10); // PCR flag
+        out.push_back(pcr >> 25);
+        out.push_back((pcr >> 17) & 0xFF);
+        out.push_back((pcr >> 9) & 0xFF);
+        out.push_back((pcr >> 1) & 0xFF);
+        out.push_back(((pcr & 1) << 7) | 0x7E); // reserved bits, extension 0
+        out.push_back(0x00);
+        out.resize(out.size() + TS_PAYLOAD - 8, 0xff); // stuffing
+    }
+    s->lastClock = clock;
+
+    int numBlocks = s->lines.size() + 1; // header and N lines
+    int numTSPackets = ((numBlocks * 46) + 183) / 184; // round up
+    int packetLength = (numTSPackets * 184) - 6;
+
+    s->continuity = (s->continuity+1)&0xf;
+    StartPacket(&out, s->pid, true, 0x10, s->continuity); // no adaption field payload only
+
+    std::size_t header = out.size();
+    out.insert(out.end(), {0x00, 0x00, 0x01, 0xBD}); // PES start code
+    out.push_back(packetLength >> 8);
+    out.push_back(packetLength & 0xff);
+
+    /* bits | 7 | 6 |  5   | 4   |     3    |     2     |     1     |     0    |
+            | 1 | 0 | Scrambling | Priority | Alignment | Copyright | Original | */
+    out.push_back(0x85); // Align, Original
+
+    /* bits |  7 | 6  |   5  |    4    |     3     |     2     |    1    |       0       |
+            | PTS DTS | ESCR | ES rate | DSM trick | copy info | PES CRC | PES extension |*/
+    out.push_back(_timing?0x80:0x00); // if timing, PTS no DTS follows
+
+    out.push_back(0x24); // PES header data length
+
+    if (_timing)
+    {
+        // append PTS
+        out.push_back(0x21 | ((pts & 0x1C0000000) >> 29));
+        out.push_back((pts & 0x3FC00000) >> 22);
+        out.push_back(0x01 | ((pts & 0x3F8000) >> 14));
+        out.push_back((pts & 0x7F80) >> 7);
+        out.push_back(0x01 | ((pts & 0x7F) << 1));
+    }
+
+    out.resize(header + 0x2D, 0xff); // make PES header up to 45 bytes long with stuffing bytes.
+
+    out.push_back(0x10); // append PES data identifier (EBU data)
+
+    for (unsigned int i = 0; i < s->lines.size(); i++)
+    {
+        if (((i % 184) % 4) == 3) // new ts packet
+        {
+            s->continuity = (s->continuity+1)&0xf;
+            StartPacket(&out, s->pid, false, 0x10, s->continuity);
+        }
+        out.insert(out.end(), s->lines[i].begin(), s->lines[i].end());
+    }
+
+    out.resize(out.size() + (numTSPackets * 4 - numBlocks) * 46, 0xff); // pad out remainder of PES packet
+
+    s->lines.clear(); // empty buffer ready for next field's packets
+
+    std::lock_guard<std::mutex> lock(_mtx);
+
+    if (primary)
+    {
+        // the tables go out ahead of the first stream's frame
+        _psi.clear();
+        if (_psiCountdown-- <= 0 || _pmtChanged)
+        {
+            _psiCountdown = TS_PSI_FRAMES - 1;
+            _pmtChanged = false;
+            _writeSection(&_psi, 0x0000, &_patContinuity, _PAT);
+            _writeSection(&_psi, _PMTPID, &_pmtContinuity, _PMT);
+        }
+        _output->write((char*)_psi.data(), _psi.size());
+        _packetsWritten += _psi.size() / TS_PACKET;
+    }
+
+    _output->write((char*)out.data(), out.size());
+    _packetsWritten += out.size() / TS_PACKET;
+
+    if (_rate && primary)
+    {
+        // pad to the constant bitrate with null packets, counting every stream's packets since the last frame
+        int64_t packetBits = TS_PACKET * 8 * 25; // credit is kept in bits * frames per second
+        _rateCredit += _rate;
+        int64_t nulls = _rateCredit / packetBits - _packetsWritten;
+        if (nulls < 0)
+        {
+            if (!_overRate)
+                _debug->Log(Debug::LogLevels::logWARN,"[TSWriter::_writeFrame] Teletext exceeds transport stream rate of " + std::to_string(_rate) + " bits per second");
+            _overRate = true;
+            _rateCredit = 0;
+            nulls = 0;
+        }
+        else
+        {
+            _rateCredit -= (_packetsWritten + nulls) * packetBits;
+        }
+        _packetsWritten = 0;
+
+        out.clear();
+        for (int64_t i = 0; i < nulls; i++)
+        {
+            StartPacket(&out, TS_NULL_PID, false, 0x10, 0);
+            out.resize(out.size() + TS_PAYLOAD, 0xff);
+        }
+        _output->write((char*)out.data(), out.size());
+    }
+}
+
+void TSWriter::Flush()
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    _output->flush();
+}
@@ -0,0 +1,101 @@
+#ifndef _TSWRITER_H_
+#define _TSWRITER_H_
+
+#include <iostream>
+#include <vector>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include "configure.h"
+#include "debug.h"
+#include "packet.h"
+#include "tables.h"
+
+namespace vbit
+{
+    /** TSWriter writes a single program MPEG-2 transport stream carrying DVB teletext PES (EN 300 472).
+     *  Several services can share one writer, each adding a stream with its own PID and language,
+     *  so that one process generates the whole teletext component of a multiplex.
+     *  Each stream collects its lines for a frame and writes them as one PES packet when the next
+     *  frame starts. The first stream added also carries the PCR, the PAT and PMT, and any null
+     *  packet padding, and the other streams take their PTS from its PCR, so all the streams share one
+     *  PCR timeline. The PMT has a teletext descriptor for each stream listing the pages a receiver
+     *  should offer.
+     */
+    class TSWriter
+    {
+        public:
+            /** An entry in the PMT's teletext descriptor */
+            struct TeletextPage
+            {
+                uint8_t type; // 0x01 initial page, 0x02 subtitles, etc. from EN 300 468
+                uint8_t magazine; // 1-8
+                uint8_t page; // 0x00-0xFF
+            };
+
+            struct Stream; // one service's teletext PES
+
+            /**
+             * @param output The stream to write to
+             * @param configure Settings of the first service, which set the PMT PID, timing and rate
+             */
+            TSWriter(std::ostream *output, Configure *configure, Debug *debug);
+
+            /** Add a stream using a service's PID and language.
+             *  @return The stream to write lines to
+             */
+            Stream* AddStream(Configure *configure);
+
+            /**
+             * Add a line to a stream's PES, writing out the stream's previous frame if a new one has started.
+             * Only one thread may write to each stream.
+             * @param clock Master clock fields since the epoch for the field the line belongs to
+             * @param line Line number within the field
+             */
+            void WriteLine(Stream *stream, std::array<uint8_t, PACKETSIZE> *p, int64_t clock, uint16_t line);
+
+            /** Replace the pages listed in the PMT for a stream. May be called from any thread. */
+            void SetTeletextPages(Stream *stream, const std::vector<TeletextPage> &pages);
+
+            void Flush();
+
+            std::ostream* GetOutput(){return _output;};
+
+        private:
+            void _writeFrame(Stream *s, int64_t clock);
+            void _writeSection(std::vector<uint8_t> *out, uint16_t pid, uint8_t *continuity, const std::vector<uint8_t> &section);
+            void _buildPMT();
+
+            std::ostream* _output;
+            Debug* _debug;
+
+            uint16_t _PMTPID;
+            bool _timing; // send PCR and PTS
+            uint32_t _rate; // bits per second, 0 for no padding
+            std::atomic<int64_t> _pcrClock; // master clock of the first stream's last PCR, -1 until one is sent
+
+            std::mutex _mtx; // guards everything below and the output
+            std::vector<Stream*> _streams;
+
+            uint8_t _patContinuity;
+            uint8_t _pmtContinuity;
+
+            std::vector<uint8_t> _PAT;
+            std::vector<uint8_t> _PMT;
+            uint8_t _pmtVersion;
+            bool _pmtChanged;
+            int _psiCountdown; // frames until the PAT and PMT are next sent
+
+            int64_t _packetsWritten; // since the last padding
+            int64_t _rateCredit; // bits * 25 available for the frames so far
+            bool _overRate; // the content has exceeded the bitrate, and a warning has been logged
+
+            std::vector<uint8_t> _psi; // transport stream packets for the tables
+    };
+}
+
+#endif // _TSWRITER_H_
@@ -76,6 +76,7 @@ void TTXLine::AppendLine(std::shared_ptr<TTXLine> line)
         {
             // line with same designation code already exists
             p->_line = line->_line; // overwrite it with our new line data but leave _nextLine unmodified
+            p->SetEncoded(nullptr); // the cached encoding is of the old data
             return;
         }
         else if ((p->GetCharAt(0)&0xF) > (line->GetCharAt(0)&0xF))
@@ -86,6 +87,8 @@ void TTXLine::AppendLine(std::shared_ptr<TTXLine> line)
             p->_line = line->_line; // move our new line data to original line
             line->_line = tmp; // move original line data into our new line
             p->_nextLine = line; // finally update _nextLine pointer to our line which now contains the original line
+            p->SetEncoded(nullptr); // both lines have changed data so drop their cached encodings
+            line->SetEncoded(nullptr);
         }
         
         if (p->_nextLine == nullptr) // reached the end of the list
@@ -39,6 +39,23 @@ class TTXLine : public std::enable_shared_from_this<TTXLine>
 
         std::shared_ptr<TTXLine> GetNextLine(){return _nextLine;}
 
+        /** A row encoded for transmission, kept with the line so that rows shared
+         *  through the RowStore are only encoded once.
+         */
+        struct Encoded
+        {
+            int requested; // coding asked for
+            int coding; // coding applied
+            bool substitute; // row has % substitutions to make at transmission
+            std::array<uint8_t, 40> data;
+        };
+
+        /** @return The cached encoding, or nullptr. Safe to call from any thread
+         *  AppendLine drops the encodings of lines in the chain whose data it changes.
+         */
+        std::shared_ptr<const Encoded> GetEncoded(){return std::atomic_load(&_encoded);}
+        void SetEncoded(std::shared_ptr<const Encoded> encoded){std::atomic_store(&_encoded, encoded);}
+
     protected:
     private:
         std::shared_ptr<TTXLine> getptr()
@@ -48,6 +65,7 @@ class TTXLine : public std::enable_shared_from_this<TTXLine>
         
         std::array<uint8_t, 40> _line; // 40 byte line
         std::shared_ptr<TTXLine> _nextLine;
+        std::shared_ptr<const Encoded> _encoded;
 };
 
 #endif // TTXLINE_H
@@ -10,9 +10,14 @@ TTXPageStream::TTXPageStream() :
     _isSpecial(false),
     _isNormal(false),
     _isUpdated(false),
+    _isSubtitle(false),
     _updateCount(0),
+    _skipCount(0),
     _deleteFlag(false),
-    _isOneShot(false)
+    _isOneShot(false),
+    _lastTransmitted(0),
+    _lastSteps(0),
+    _longestGap(0)
 {
     //ctor
     _mtx.reset(new std::mutex());
@@ -31,24 +36,58 @@ bool TTXPageStream::GetLock()
     return false; // couldn't get mutex
 }
 
+void TTXPageStream::UpdateSubtitleFlag()
+{
+    std::vector<std::shared_ptr<Subpage>> subpages = GetSubpages();
+    _isSubtitle = !subpages.empty() && (subpages.front()->GetSubpageStatus() & PAGESTATUS_C6_SUBTITLE);
+}
+
 void TTXPageStream::FreeLock()
 {
     _mtx->unlock();
 }
 
+int64_t TTXPageStream::GetUntransmitted()
+{
+    uint32_t steps = MasterClock::Instance()->GetSteps(); // read first, so a step between the reads discards the gap
+    if (!_lastTransmitted || steps != _lastSteps)
+        return 0;
+    return MasterClock::Instance()->GetFields() - _lastTransmitted;
+}
+
+int64_t TTXPageStream::Transmitted()
+{
+    int64_t gap = GetUntransmitted();
+    _lastSteps = MasterClock::Instance()->GetSteps();
+    _lastTransmitted = MasterClock::Instance()->GetFields();
+    if (gap <= _longestGap)
+        return 0;
+    _longestGap = gap;
+    return gap;
+}
+
 void TTXPageStream::IncrementUpdateCount()
 {
     _updateCount = (_updateCount + 1) % 8;
 }
 
+bool TTXPageStream::SkipCycle()
+{
+    if (GetRepeat() >= -1)
+        return false;
+    
+    bool skip = _skipCount != 0;
+    _skipCount = (_skipCount + 1) % -GetRepeat();
+    return skip;
+}
+
 void TTXPageStream::SetTransitionTime(uint8_t cycleTime)
 {
     if (std::shared_ptr<Subpage> s = GetSubpage())
     {
         if (s->GetTimedMode())
         {
-            MasterClock *mc = mc->Instance();
-            _transitionTime = mc->GetMasterClock().seconds + cycleTime;
+            _transitionTime = MasterClock::Instance()->GetSeconds() + cycleTime;
         }
         else
         {
@@ -64,10 +103,9 @@ bool TTXPageStream::Expired(bool StepCycles)
     {
         if (s->GetTimedMode())
         {
-            MasterClock *mc = mc->Instance();
             if (_transitionTime == 0)
                 return false; // catch race condition where we can check carousel before its timeout has been set
-            return _transitionTime <= mc->GetMasterClock().seconds;
+            return _transitionTime <= MasterClock::Instance()->GetSeconds();
         }
     }
     
@@ -2,6 +2,7 @@
 #define _TTXPAGESTREAM_H_
 
 #include <mutex>
+#include <atomic>
 #include <sys/stat.h>
 #include <memory>
 
@@ -41,14 +42,28 @@ class TTXPageStream : public Page
         bool GetUpdatedFlag() { return _isUpdated; }
         void SetUpdatedFlag(bool val) { _isUpdated = val; } // must only be set by UpdatedPages!
         
+        /** Note whether the first subpage is a subtitle page, for threads which can't take the page lock.
+         *  Call from whoever holds the page, after changing its subpages.
+         */
+        void UpdateSubtitleFlag();
+        bool IsSubtitle() { return _isSubtitle; }
+        
         int GetUpdateCount() {return _updateCount;}
         void IncrementUpdateCount();
+        
+        /** Used by NormalPages for pages with a negative repeat
+         *  @return true if the page should sit out this magazine cycle
+         */
+        bool SkipCycle();
 
         /** Set the time when this carousel expires
          *  which is the current time plus the cycle time
          *  or the number of page cycles remaining
          */
         void SetTransitionTime(uint8_t cycleTime);
+        
+        /** @return master clock second of the next timed carousel transition, or 0 if none is set */
+        time_t GetTransitionTime() { return _transitionTime; }
 
         /** Used to time carousels
          *  If StepCycles is set, decrement page cycle count
@@ -60,6 +75,13 @@ class TTXPageStream : public Page
         
         bool GetLock();
         void FreeLock();
+        
+        /** Record that the page is being transmitted
+         *  @return The time since the page was last transmitted, if that is the longest yet, otherwise 0
+         */
+        int64_t Transmitted();
+        /** @return Master clock fields since the page was last transmitted, or 0 if it never has been or the clock has been stepped since */
+        int64_t GetUntransmitted();
 
         /** Used to enable list->remove
          */
@@ -91,13 +113,19 @@ class TTXPageStream : public Page
         bool _isSpecial;
         bool _isNormal;
         bool _isUpdated;
+        std::atomic<bool> _isSubtitle; // read by the service thread to list subtitle pages in the PMT
 
         int _updateCount; // update counter for special pages.
+        int _skipCount; // magazine cycles since a page with a negative repeat was last sent
         
         bool _deleteFlag; // marks a page for deletion from the service and cannot be undone
         
         bool _isOneShot;
         
+        int64_t _lastTransmitted; // master clock fields, 0 if never
+        uint32_t _lastSteps; // master clock steps when it was
+        int64_t _longestGap;
+        
         std::shared_ptr<std::mutex> _mtx;
 };
 };
@@ -66,7 +66,8 @@ std::shared_ptr<TTXPageStream> UpdatedPages::NextPage()
             }
             else
             {
-                // skip page
+                // skip page, it stays in the list to try again
+                _debug->PageLockFailed(_page->GetPageNumber(), false, _page->GetUntransmitted());
                 ++_iter;
                 _page = *_iter;
             }
@@ -25,6 +25,8 @@ class UpdatedPages
         void addPage(std::shared_ptr<TTXPageStream> p);
         
         bool waiting(){ return _UpdatedPagesList.size() > 0; };
+        
+        int Size(){ return _UpdatedPagesList.size(); };
 
     protected:
 
@@ -2,57 +2,208 @@
 
 using namespace vbit;
 
-MasterClock *MasterClock::instance = 0; // initialise MasterClock singleton
-
 /* Options
  * --dir <path to pages>
  * Sets the pages directory and the location of vbit.conf.
+ * --dry-run
+ * Loads the pages, prints the predicted cycle time of each magazine, and exits.
+ * --output <path>
+ * Write the output stream to a file or named pipe instead of stdout.
+ * --cpu <n>
+ * Run the service thread on processor n.
+ * --monitor-cpu <n>
+ * Run the service's file monitor thread on processor n.
+ * --server-cpu <n>
+ * Run the packet server, interface server and metrics server threads on processor n.
+ * --rtprio <1-99>
+ * Run the service thread with SCHED_FIFO real-time priority.
+ * --mlock
+ * Lock vbit2 into RAM and prefault the service thread's stack. Applies to the whole process.
+ * --pmtpid <pid>
+ * PID of the program map table in ts and tsnpts output. Defaults to 4096.
+ * --tsrate <bits per second>
+ * Pad ts and tsnpts output with null packets to a constant bitrate.
+ * --language <code>
+ * ISO 639 language of the teletext in ts and tsnpts output. Defaults to und.
+ * Services in a --services file with ts output to the same --output share one transport stream.
+ * Each needs its own --pid. The first service's --pmtpid, --tsrate and format apply to the stream.
+ * --metrics <port>
+ * Serve counters and gauges for monitoring systems at http://host:port/metrics in Prometheus text format.
+ * --fieldclock <path|udp:port>
+ * Follow an external field clock from a named pipe or UDP port instead of the local clock.
+ * See scripts/fieldclock.py.
+ * --services <file>
+ * Run several services in this process. Must be the only option.
+ * Each service=<options> line in the file takes the options above for one service.
+ *
+ * Send SIGUSR1 to write how long each stage of the services is taking, and what the VBI lines
+ * have been used for, to stderr.
  */
 
+#ifndef WIN32
+/* SIGUSR1 dumps the stage latency histograms of every service to stderr */
+static void DumpHandler(int)
+{
+    Debug::RequestDump();
+}
+#endif
+
+/* Read the option lists for each service from a services file */
+static void LoadServices(std::string filename, std::vector<std::vector<std::string>> *services)
+{
+    std::ifstream filein(filename.c_str());
+    if (!filein.is_open())
+    {
+        std::cerr << "unable to open services file " << filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+    
+    std::string line;
+    while (std::getline(filein >> std::ws, line))
+    {
+        if (line.empty() || line.front() == ';') // ignore comments
+            continue;
+        
+        if (line.compare(0, 8, "service="))
+        {
+            std::cerr << "invalid services file line: " << line << "\n";
+            exit(EXIT_FAILURE);
+        }
+        
+        std::vector<std::string> args;
+        std::istringstream ss(line.substr(8));
+        std::string arg;
+        while (ss >> arg)
+            args.push_back(arg);
+        services->push_back(args);
+    }
+    
+    if (services->empty())
+    {
+        std::cerr << "no services defined in " << filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+}
+
 int main(int argc, char** argv)
 {
     #ifdef WIN32
     _setmode(_fileno(stdout), _O_BINARY); // set stdout to binary mode stdout to avoid pesky line ending conversion
+    #else
+    signal(SIGUSR1, DumpHandler);
     #endif
     
-    Debug *debug=new Debug();
-    
-    /// @todo option of adding a non standard config path
-    Configure *configure=new Configure(debug, argc, argv);
-    
-    // attempt to use system locale for strftime
-    if (std::setlocale(LC_TIME, "") == nullptr)
+    std::vector<std::vector<std::string>> services; // command line options for each service
+    if (argc > 1 && std::string(argv[1]) == "--services")
+    {
+        if (argc != 3)
+        {
+            std::cerr << "--services requires a file name and no other options\n";
+            exit(EXIT_FAILURE);
+        }
+        LoadServices(argv[2], &services);
+    }
+    else
     {
-        debug->Log(Debug::LogLevels::logERROR,"[main] Unable to set locale");
+        services.push_back(std::vector<std::string>(argv + 1, argv + argc));
     }
     
-    PageList *pageList=new PageList(configure, debug);
-    PacketServer *packetServer=new PacketServer(configure, debug);
-    InterfaceServer *interfaceServer=new InterfaceServer(configure, debug, pageList);
-
-    Service* svc=new Service(configure, debug, pageList, packetServer, interfaceServer); // Need to copy the subtitle packet source for Newfor
+    // attempt to use system locale for strftime
+    bool locale = std::setlocale(LC_TIME, "") != nullptr;
+    
+    std::vector<std::thread> monitorThreads;
+    std::vector<std::thread> serviceThreads;
+    bool lockMemory = false;
+    
+    for (unsigned int n=0; n<services.size(); n++)
+    {
+        std::vector<char*> args;
+        args.push_back(argv[0]);
+        for (unsigned int i=0; i<services[n].size(); i++)
+            args.push_back(&services[n][i][0]);
+        
+        Debug *debug=new Debug();
+        
+        /// @todo option of adding a non standard config path
+        Configure *configure=new Configure(debug, args.size(), args.data());
+        
+        if (!locale)
+        {
+            debug->Log(Debug::LogLevels::logERROR,"[main] Unable to set locale");
+        }
+        
+        PageList *pageList=new PageList(configure, debug);
+        
+        if (configure->GetDryRun())
+        {
+            FileMonitor(configure, debug, pageList).Scan(true);
+            
+            CyclePredictor predictor(configure, pageList);
+            std::array<CyclePredictor::Prediction, 8> prediction = predictor.Predict();
+            
+            std::cout << configure->GetPageDirectory() << "\n";
+            std::cout << "mag  pages  packets  cycle (s)\n";
+            for (int i=1; i<=8; i++)
+            {
+                CyclePredictor::Prediction p = prediction[i&7];
+                std::cout << std::setw(3) << i << std::setw(7) << p.pages << std::setw(9) << p.packets << std::setw(11) << std::fixed << std::setprecision(1) << (p.pages?p.fields/50.0:0) << "\n";
+            }
+            continue;
+        }
+        
+        PacketServer *packetServer=new PacketServer(configure, debug);
+        InterfaceServer *interfaceServer=new InterfaceServer(configure, debug, pageList);
 
-    std::thread monitorThread(&FileMonitor::run, FileMonitor(configure, debug, pageList));
-    std::thread serviceThread(&Service::run, svc);
+        Service* svc=new Service(configure, debug, pageList, packetServer, interfaceServer, n==0); // the first service keeps the master clock
+        
+        if (configure->GetLockMemory() && !lockMemory)
+        {
+            LockMemory(debug); // before the service starts so that its buffers are locked as they are allocated
+            lockMemory = true;
+        }
+        
+        serviceThreads.push_back(std::thread(&Service::run, svc)); // the service sets its own cpu and priority
+        
+        monitorThreads.push_back(std::thread(&FileMonitor::run, new FileMonitor(configure, debug, pageList))); // each service has its own file monitor
+        if (configure->GetMonitorCPU() >= 0)
+            SetThreadCPU(&monitorThreads.back(), configure->GetMonitorCPU(), debug, "file monitor");
 
-    if (configure->GetPacketServerEnabled())
-    {
-        // only start packet server thread if required
-        std::thread packetServerThread(&PacketServer::run, packetServer );
-        packetServerThread.detach();
-    }
+        if (configure->GetPacketServerEnabled())
+        {
+            // only start packet server thread if required
+            std::thread packetServerThread(&PacketServer::run, packetServer );
+            if (configure->GetServerCPU() >= 0)
+                SetThreadCPU(&packetServerThread, configure->GetServerCPU(), debug, "packet server");
+            packetServerThread.detach();
+        }
 
-    if (configure->GetInterfaceServerEnabled())
-    {
-        // only start interface server thread if required
-        std::thread interfaceServerThread(&InterfaceServer::run, interfaceServer );
-        interfaceServerThread.detach();
+        if (configure->GetInterfaceServerEnabled())
+        {
+            // only start interface server thread if required
+            std::thread interfaceServerThread(&InterfaceServer::run, interfaceServer );
+            if (configure->GetServerCPU() >= 0)
+                SetThreadCPU(&interfaceServerThread, configure->GetServerCPU(), debug, "interface server");
+            interfaceServerThread.detach();
+        }
+        
+        if (configure->GetMetricsServerEnabled())
+        {
+            MetricsServer *metricsServer=new MetricsServer(configure, debug, packetServer, interfaceServer);
+            std::thread metricsServerThread(&MetricsServer::run, metricsServer);
+            if (configure->GetServerCPU() >= 0)
+                SetThreadCPU(&metricsServerThread, configure->GetServerCPU(), debug, "metrics server");
+            metricsServerThread.detach();
+        }
     }
-
+    
+    if (serviceThreads.empty())
+        return 0; // dry run
+    
     // The threads should never stop, but just in case...
-    monitorThread.join();
-    serviceThread.join();
+    for (unsigned int n=0; n<monitorThreads.size(); n++)
+        monitorThreads[n].join();
+    for (unsigned int n=0; n<serviceThreads.size(); n++)
+        serviceThreads[n].join();
 
     return 0;
 }
-
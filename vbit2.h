@@ -4,6 +4,9 @@
 #include <iostream>
 #include <thread>
 #include <clocale>
+#include <fstream>
+#include <sstream>
+#include <vector>
 #include "service.h"
 #include "configure.h"
 #include "debug.h"
@@ -11,10 +14,17 @@
 #include "filemonitor.h"
 #include "packetServer.h"
 #include "interfaceServer.h"
+#include "metricsServer.h"
 #include "masterClock.h"
+#include "cyclePredictor.h"
+#include "realtime.h"
 
 #ifdef WIN32
 #include "fcntl.h"
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <csignal>
 #endif
 
 namespace vbit